@@ -0,0 +1,78 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "AllocationCounter.h"
+
+#ifdef ALLOCATION_COUNTER
+static volatile uint32_t allocations = 0;
+
+extern "C" {
+  void* __real_malloc(size_t size);
+  void* __real_calloc(size_t count, size_t size);
+  void* __real_realloc(void* ptr, size_t size);
+
+  void* __wrap_malloc(size_t size) {
+    allocations++;
+    return __real_malloc(size);
+  }
+
+  void* __wrap_calloc(size_t count, size_t size) {
+    allocations++;
+    return __real_calloc(count, size);
+  }
+
+  void* __wrap_realloc(void* ptr, size_t size) {
+    allocations++;
+    return __real_realloc(ptr, size);
+  }
+}
+#endif
+
+boolean AllocationCounter::isEnabled() {
+#ifdef ALLOCATION_COUNTER
+  return true;
+#else
+  return false;
+#endif
+}
+
+uint32_t AllocationCounter::getCount() {
+#ifdef ALLOCATION_COUNTER
+  return allocations;
+#else
+  return 0;
+#endif
+}
+
+// Logs how many allocations were made since the last report
+void AllocationCounter::report() {
+  if (!isEnabled()) {
+    return;
+  }
+  uint32_t count = getCount();
+  Serial.printf("Heap allocations: %u in the last %lus, free heap %u\n",
+    (unsigned)(count - lastCount), (millis() - lastReport) / 1000, (unsigned)ESP.getFreeHeap());
+  lastCount = count;
+  lastReport = millis();
+}
@@ -0,0 +1,547 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "AsyncHttpClient.h"
+#include "ReachabilityProbe.h"
+
+boolean AsyncHttpClient::begin(const char* server, int port, const char* requestLine, const char* headerBlock,
+    const ResponseFingerprint* fingerprint, const char* postBody, JsonStreamExtractor* extractor) {
+  if (isBusy()) {
+    return false;
+  }
+  reset();
+  strncpy(myServer, server, sizeof(myServer) - 1);
+  myServer[sizeof(myServer) - 1] = '\0';
+  myPort = port;
+  retried = false;
+  started = millis();
+  lastActivity = started;
+  state = HTTP_CONNECTING;
+
+  if (!queue(requestLine, headerBlock, fingerprint, postBody, extractor)) {
+    fail("Request to %s too large", myServer);
+    return false;
+  }
+  return true;
+}
+
+// Adds a request behind the ones already queued, until the first one is sent.
+// Assembles it in the fixed buffer; headerBlock ends with CRLF for every line.
+boolean AsyncHttpClient::queue(const char* requestLine, const char* headerBlock,
+    const ResponseFingerprint* fingerprint, const char* postBody, JsonStreamExtractor* extractor) {
+  if (state != HTTP_CONNECTING || requestCount >= HTTP_PIPELINE_DEPTH) {
+    return false;
+  }
+  requestStart[requestCount] = requestLength;
+  requestHead[requestCount] = (strncmp(requestLine, "HEAD ", 5) == 0);
+  requestExtractor[requestCount] = extractor;
+
+  boolean fits = append(requestLine) && append("\r\n") && append(headerBlock);
+  // validators let the server answer 304 if it supports them
+  if (fits && fingerprint != NULL && fingerprint->valid) {
+    if (fingerprint->etag != "") {
+      fits = append("If-None-Match: ") && append(fingerprint->etag.c_str()) && append("\r\n");
+    }
+    if (fits && fingerprint->lastModified != "") {
+      fits = append("If-Modified-Since: ") && append(fingerprint->lastModified.c_str()) && append("\r\n");
+    }
+  }
+  if (fits && postBody != NULL && postBody[0] != '\0') {
+    char length[12];
+    sprintf(length, "%u", (unsigned int)strlen(postBody));
+    fits = append("Content-Type: application/json\r\nContent-Length: ") && append(length) && append("\r\n");
+  }
+  fits = fits && append("\r\n");
+  if (fits && postBody != NULL) {
+    fits = append(postBody);
+  }
+  if (!fits) {
+    // drop the partial request, the ones before it are still complete
+    requestLength = requestStart[requestCount];
+    request[requestLength] = '\0';
+    return false;
+  }
+  requestCount++;
+  return true;
+}
+
+void AsyncHttpClient::reset() {
+  if (client != NULL) {
+    connectionPool.release(client, false);
+    client = NULL;
+  }
+  state = HTTP_IDLE;
+  requestLength = 0;
+  request[0] = '\0';
+  requestCount = 0;
+  responseIndex = 0;
+  sendOffset = 0;
+  error[0] = '\0';
+  resetResponse();
+}
+
+void AsyncHttpClient::resetResponse() {
+  lineLength = 0;
+  statusLine.clear();
+  statusCode = 0;
+  contentLength = -1;
+  received = 0;
+  keepAlive = true;
+  chunked = false;
+  chunkState = CHUNK_SIZE;
+  chunkRemaining = 0;
+  body = "";
+  extractor = NULL;
+  bodyHash = 2166136261UL; // FNV-1a offset basis
+  etag.clear();
+  lastModified.clear();
+}
+
+// True when the current response is done and a pipelined one follows
+boolean AsyncHttpClient::hasNext() {
+  return state == HTTP_DONE && responseIndex < requestCount - 1;
+}
+
+// Moves on to the next pipelined response, dropping the current body
+void AsyncHttpClient::next() {
+  if (!hasNext()) {
+    return;
+  }
+  responseIndex++;
+  resetResponse();
+  lastActivity = millis();
+  if (client == NULL) {
+    // the server closed the connection, send the unanswered requests again
+    sendOffset = requestStart[responseIndex];
+    state = HTTP_CONNECTING;
+  } else {
+    state = HTTP_READING_HEADERS;
+  }
+}
+
+// Starts over on a new connection with the requests that have no response yet
+void AsyncHttpClient::resend() {
+  connectionPool.release(client, false);
+  client = NULL;
+  retried = true;
+  sendOffset = requestStart[responseIndex];
+  lastActivity = millis();
+  state = HTTP_CONNECTING;
+}
+
+void AsyncHttpClient::handle() {
+  unsigned long start = millis();
+  boolean progress = true;
+  while (isBusy() && progress && millis() - start < HTTP_LOOP_BUDGET) {
+    switch (state) {
+      case HTTP_CONNECTING:
+        progress = connect();
+        break;
+      case HTTP_SENDING:
+        send();
+        break;
+      case HTTP_READING_HEADERS:
+        progress = readHeaders();
+        break;
+      case HTTP_READING_BODY:
+        progress = readBody();
+        break;
+      default:
+        break;
+    }
+  }
+  if (state == HTTP_CONNECTING && millis() - lastActivity > HTTP_CONNECT_TIMEOUT) {
+    fail("Timeout connecting to %s:%d", myServer, myPort); // e.g. DNS never answered
+  } else if (isBusy() && millis() - lastActivity > HTTP_RESPONSE_TIMEOUT) {
+    fail("Timeout waiting for %s:%d", myServer, myPort);
+  }
+}
+
+boolean AsyncHttpClient::append(const char* text) {
+  size_t length = strlen(text);
+  if (requestLength + length >= sizeof(request)) {
+    return false;
+  }
+  memcpy(request + requestLength, text, length + 1);
+  requestLength += length;
+  return true;
+}
+
+boolean AsyncHttpClient::connect() {
+  IPAddress address;
+  DnsResult dns = dnsCache.resolve(myServer, address);
+  if (dns == DNS_PENDING) {
+    return false; // lwIP calls back, try again on the next handle()
+  }
+  if (dns == DNS_FAILED) {
+    fail("Could not resolve %s", myServer);
+    return true;
+  }
+  // The one blocking step: WiFiClient has no asynchronous connect, so opening a
+  // new connection holds loop() until the server accepts, for at most what is
+  // left of HTTP_CONNECT_TIMEOUT after the DNS lookup. A reused connection
+  // returns at once.
+  unsigned long elapsed = millis() - lastActivity;
+  unsigned long timeout = elapsed < HTTP_CONNECT_TIMEOUT ? HTTP_CONNECT_TIMEOUT - elapsed : 1;
+  client = connectionPool.acquire(myServer, address, myPort, timeout);
+  if (client == NULL) {
+    fail("Connection to %s:%d failed.", myServer, myPort);
+    return true;
+  }
+  reused = connectionPool.isLastReused();
+  lastActivity = millis();
+  state = HTTP_SENDING;
+  return true;
+}
+
+void AsyncHttpClient::send() {
+  size_t written = client->write((const uint8_t*)request + sendOffset, requestLength - sendOffset);
+  connectionPool.recordWrite();
+  if (written != requestLength - sendOffset) {
+    if (reused && !retried) {
+      // the idle keep-alive connection was closed by the server, start over on a new one
+      resend();
+      return;
+    }
+    fail("Connection to %s:%d failed.", myServer, myPort);
+    return;
+  }
+  lastActivity = millis();
+  state = HTTP_READING_HEADERS;
+}
+
+boolean AsyncHttpClient::readHeaders() {
+  if (!client->available()) {
+    if (!client->connected()) {
+      // an idle keep-alive connection, or one the server closed in the middle of a pipeline
+      if ((reused || responseIndex > 0) && !retried && statusCode == 0 && lineLength == 0) {
+        resend();
+        return true;
+      }
+      fail("Invalid response from %s:%d", myServer, myPort);
+    }
+    return false;
+  }
+  lastActivity = millis();
+  while (client->available()) {
+    char c = client->read();
+    if (c == '\r') {
+      continue;
+    }
+    if (c != '\n') {
+      if (!appendLine(c)) {
+        return false;
+      }
+      continue;
+    }
+    line[lineLength] = '\0';
+    if (statusCode == 0) {
+      statusLine = line;
+      const char* space = strchr(line, ' ');
+      statusCode = space != NULL ? atoi(space + 1) : 0;
+      if (statusCode <= 0) {
+        fail("Invalid response from %s:%d", myServer, myPort);
+        return false;
+      }
+    } else if (lineLength == 0) {
+      // end of headers
+      if (requestHead[responseIndex] || statusCode == 204 || statusCode == 304 || (contentLength == 0 && !chunked)) {
+        finish();
+      } else {
+        if (statusCode == 200 && requestExtractor[responseIndex] != NULL) {
+          extractor = requestExtractor[responseIndex];
+          extractor->begin();
+        } else if (contentLength > 0 && !chunked) {
+          body.reserve(contentLength);
+        }
+        state = HTTP_READING_BODY;
+      }
+      lineLength = 0;
+      return true;
+    } else {
+      parseHeader();
+    }
+    lineLength = 0;
+  }
+  return true;
+}
+
+// Adds one character to the status, header or chunk line being read; a line that
+// does not fit fails the request rather than being misread
+boolean AsyncHttpClient::appendLine(char c) {
+  if (lineLength >= HTTP_LINE_SIZE - 1) {
+    fail("Header line too long from %s:%d", myServer, myPort);
+    return false;
+  }
+  line[lineLength++] = c;
+  return true;
+}
+
+// Picks the framing and validators out of the header line in line; it is changed in place
+void AsyncHttpClient::parseHeader() {
+  char* colon = strchr(line, ':');
+  if (colon == NULL || colon == line) {
+    return;
+  }
+  *colon = '\0';
+  const char* name = line;
+  char* value = colon + 1;
+  while (*value == ' ' || *value == '\t') {
+    value++;
+  }
+  char* end = line + lineLength;
+  while (end > value && (end[-1] == ' ' || end[-1] == '\t')) {
+    *--end = '\0';
+  }
+  if (strcasecmp(name, "content-length") == 0) {
+    contentLength = atol(value);
+  } else if (strcasecmp(name, "connection") == 0) {
+    if (strcasecmp(value, "close") == 0) {
+      keepAlive = false;
+    }
+  } else if (strcasecmp(name, "transfer-encoding") == 0) {
+    for (char* c = value; *c != '\0'; c++) {
+      *c = tolower(*c);
+    }
+    if (strstr(value, "chunked") != NULL) {
+      chunked = true;
+    } else {
+      keepAlive = false; // body is only framed by the connection closing
+    }
+  } else if (strcasecmp(name, "etag") == 0) {
+    keepValidator(etag, value);
+  } else if (strcasecmp(name, "last-modified") == 0) {
+    keepValidator(lastModified, value);
+  }
+}
+
+// A cut validator would never match, so one that does not fit is not kept at all
+void AsyncHttpClient::keepValidator(FixedStringBase &validator, const char* value) {
+  if (strlen(value) > validator.getCapacity()) {
+    validator.clear();
+  } else {
+    validator.assign(value);
+  }
+}
+
+boolean AsyncHttpClient::readBody() {
+  if (chunked) {
+    return readChunked();
+  }
+  char buffer[128];
+  int available = client->available();
+  if (available <= 0) {
+    if (!client->connected()) {
+      if (contentLength < 0) {
+        keepAlive = false;
+        finish();
+      } else {
+        fail("Invalid response from %s:%d", myServer, myPort);
+      }
+    }
+    return false;
+  }
+  lastActivity = millis();
+  long wanted = available < (int)sizeof(buffer) ? available : sizeof(buffer);
+  if (contentLength >= 0 && wanted > contentLength - received) {
+    wanted = contentLength - received;
+  }
+  int count = client->read((uint8_t*)buffer, wanted);
+  appendBody(buffer, count);
+  if (contentLength >= 0 && received >= contentLength) {
+    finish();
+  }
+  return true;
+}
+
+// Transfer-Encoding: chunked, decoded as it arrives: size line, data, CRLF ... 0, trailers
+boolean AsyncHttpClient::readChunked() {
+  if (!client->available()) {
+    if (!client->connected()) {
+      fail("Invalid response from %s:%d", myServer, myPort);
+    }
+    return false;
+  }
+  lastActivity = millis();
+
+  if (chunkState == CHUNK_DATA) {
+    char buffer[128];
+    long wanted = client->available();
+    if (wanted > (long)sizeof(buffer)) {
+      wanted = sizeof(buffer);
+    }
+    if (wanted > chunkRemaining) {
+      wanted = chunkRemaining;
+    }
+    int count = client->read((uint8_t*)buffer, wanted);
+    appendBody(buffer, count);
+    if (count > 0) {
+      chunkRemaining -= count;
+    }
+    if (chunkRemaining == 0) {
+      chunkState = CHUNK_DATA_END;
+    }
+    return true;
+  }
+
+  while (client->available()) {
+    char c = client->read();
+    if (c == '\r') {
+      continue;
+    }
+    if (c != '\n') {
+      if (!appendLine(c)) {
+        return false;
+      }
+      continue;
+    }
+    line[lineLength] = '\0';
+    if (chunkState == CHUNK_SIZE) {
+      // chunk extensions after ';' are ignored by strtol
+      chunkRemaining = strtol(line, NULL, 16);
+      lineLength = 0;
+      if (chunkRemaining > 0) {
+        if (extractor == NULL) {
+          body.reserve(body.length() + chunkRemaining);
+        }
+        chunkState = CHUNK_DATA;
+      } else {
+        chunkState = CHUNK_TRAILER;
+      }
+      return true;
+    }
+    if (chunkState == CHUNK_DATA_END) {
+      lineLength = 0;
+      chunkState = CHUNK_SIZE;
+      continue;
+    }
+    // trailer headers are not used, an empty line ends the body
+    if (lineLength == 0) {
+      finish();
+      return true;
+    }
+    lineLength = 0;
+  }
+  return true;
+}
+
+void AsyncHttpClient::appendBody(const char* data, int count) {
+  if (count <= 0) {
+    return;
+  }
+  if (extractor != NULL) {
+    extractor->feed(data, count);
+  } else {
+    body.concat(data, count);
+  }
+  received += count;
+  for (int inx = 0; inx < count; inx++) {
+    bodyHash = (bodyHash ^ (uint8_t)data[inx]) * 16777619UL;
+  }
+}
+
+void AsyncHttpClient::finish() {
+  state = HTTP_DONE;
+  if (hasNext()) {
+    if (!keepAlive) {
+      // next() reconnects for the rest of the pipeline
+      connectionPool.release(client, false);
+      client = NULL;
+    }
+    return;
+  }
+  connectionPool.release(client, keepAlive);
+  client = NULL;
+  connectionPool.recordLatency(reused, millis() - started);
+  connectionPool.printStats();
+  dnsCache.printStats();
+  reachability.printStats();
+}
+
+// The message is formatted straight into the error buffer, no Strings are built for it
+void AsyncHttpClient::fail(const char* pattern, ...) {
+  if (client != NULL) {
+    connectionPool.release(client, false);
+    client = NULL;
+  }
+  va_list args;
+  va_start(args, pattern);
+  vsnprintf(error, sizeof(error), pattern, args);
+  va_end(args);
+  Serial.println(error);
+  state = HTTP_FAILED;
+}
+
+boolean AsyncHttpClient::isBusy() {
+  return state != HTTP_IDLE && state != HTTP_DONE && state != HTTP_FAILED;
+}
+
+boolean AsyncHttpClient::isDone() {
+  return state == HTTP_DONE;
+}
+
+boolean AsyncHttpClient::isFailed() {
+  return state == HTTP_FAILED;
+}
+
+int AsyncHttpClient::getStatusCode() {
+  return statusCode;
+}
+
+const char* AsyncHttpClient::getStatusLine() {
+  return statusLine.c_str();
+}
+
+String &AsyncHttpClient::getBody() {
+  return body;
+}
+
+// True if the body went to the request's extractor rather than getBody()
+boolean AsyncHttpClient::isStreamed() {
+  return extractor != NULL;
+}
+
+String AsyncHttpClient::getError() {
+  return error;
+}
+
+// True if the finished response is a 304 or has the same body as last time
+boolean AsyncHttpClient::isUnchanged(ResponseFingerprint &fingerprint) {
+  boolean unchanged = (statusCode == 304) || (fingerprint.valid && fingerprint.hash == bodyHash);
+  if (statusCode != 304) {
+    fingerprint.valid = true;
+    fingerprint.hash = bodyHash;
+    fingerprint.etag = etag;
+    fingerprint.lastModified = lastModified;
+  }
+  if (unchanged) {
+    connectionPool.recordSkippedParse();
+  }
+  return unchanged;
+}
+
+void AsyncHttpClient::clearFingerprint(ResponseFingerprint &fingerprint) {
+  fingerprint.valid = false;
+  fingerprint.etag.clear();
+  fingerprint.lastModified.clear();
+}
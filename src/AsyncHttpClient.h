@@ -0,0 +1,150 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <ESP8266WiFi.h>
+#include "HttpConnectionPool.h"
+#include "DnsCache.h"
+#include "JsonStreamExtractor.h"
+#include "FixedString.h"
+
+#define HTTP_CONNECT_TIMEOUT 3000   // ms allowed for DNS and the TCP connect together
+#define HTTP_RESPONSE_TIMEOUT 5000  // ms the server may stay silent before we give up
+#define HTTP_LOOP_BUDGET 5          // ms of work done per handle() call
+#define HTTP_REQUEST_SIZE 768       // all pipelined requests (line + headers + body), sent in one write
+#define HTTP_PIPELINE_DEPTH 3       // requests that can be queued on one connection
+#define HTTP_HEADER_BLOCK_SIZE 256  // per client headers rendered once when the settings change
+#define HTTP_ERROR_SIZE 160         // the last failure, e.g. "Connection to <server>:<port> failed."
+#define HTTP_LINE_SIZE 256          // longest status, header or chunk size line; longer ones fail the request
+#define HTTP_STATUS_LINE_SIZE 64    // kept for error messages, longer reason phrases are cut
+#define HTTP_VALIDATOR_SIZE 64      // longest ETag / Last-Modified kept, longer ones are not sent back
+
+// What the last response of one endpoint looked like, so an identical one can be skipped
+typedef struct {
+  boolean valid = false;
+  uint32_t hash = 0;
+  FixedString<HTTP_VALIDATOR_SIZE> etag;
+  FixedString<HTTP_VALIDATOR_SIZE> lastModified;
+} ResponseFingerprint;
+
+// Non-blocking HTTP/1.1 request engine. begin() queues a request and every
+// call to handle() from loop() advances it a few milliseconds:
+// connect -> send -> read headers -> read body -> done / failed.
+// More requests to the same server can be pipelined with queue(); their
+// responses are handed out one at a time with hasNext() / next().
+// A request given an extractor has its 200 response streamed into it
+// instead of being kept in the body. Status and header lines are read into
+// fixed buffers; only a body that is not streamed is kept in a String.
+class AsyncHttpClient {
+
+private:
+  enum ChunkState {
+    CHUNK_SIZE,
+    CHUNK_DATA,
+    CHUNK_DATA_END,
+    CHUNK_TRAILER
+  };
+
+  enum HttpState {
+    HTTP_IDLE,
+    HTTP_CONNECTING,
+    HTTP_SENDING,
+    HTTP_READING_HEADERS,
+    HTTP_READING_BODY,
+    HTTP_DONE,
+    HTTP_FAILED
+  };
+
+  HttpState state = HTTP_IDLE;
+  char myServer[100] = "";
+  int myPort = 80;
+  char request[HTTP_REQUEST_SIZE];
+  size_t requestLength = 0;
+  size_t requestStart[HTTP_PIPELINE_DEPTH];
+  boolean requestHead[HTTP_PIPELINE_DEPTH];
+  JsonStreamExtractor* requestExtractor[HTTP_PIPELINE_DEPTH];
+  int requestCount = 0;
+  int responseIndex = 0;
+  size_t sendOffset = 0;
+
+  WiFiClient* client = NULL;
+  boolean reused = false;
+  boolean retried = false;
+
+  char line[HTTP_LINE_SIZE];
+  size_t lineLength = 0;
+  FixedString<HTTP_STATUS_LINE_SIZE> statusLine;
+  int statusCode = 0;
+  long contentLength = -1;
+  long received = 0;
+  boolean keepAlive = true;
+  boolean chunked = false;
+  ChunkState chunkState = CHUNK_SIZE;
+  long chunkRemaining = 0;
+  String body;
+  JsonStreamExtractor* extractor = NULL;
+  uint32_t bodyHash = 0;
+  FixedString<HTTP_VALIDATOR_SIZE> etag;
+  FixedString<HTTP_VALIDATOR_SIZE> lastModified;
+  char error[HTTP_ERROR_SIZE] = "";
+
+  unsigned long started = 0;
+  unsigned long lastActivity = 0;
+
+  boolean append(const char* text);
+  void resetResponse();
+  void resend();
+  boolean connect();
+  void send();
+  boolean readHeaders();
+  boolean readBody();
+  boolean readChunked();
+  void appendBody(const char* data, int count);
+  boolean appendLine(char c);
+  void parseHeader();
+  static void keepValidator(FixedStringBase &validator, const char* value);
+  void finish();
+  void fail(const char* pattern, ...) __attribute__ ((format (printf, 2, 3)));
+
+public:
+  boolean begin(const char* server, int port, const char* requestLine, const char* headerBlock,
+    const ResponseFingerprint* fingerprint = NULL, const char* postBody = NULL, JsonStreamExtractor* extractor = NULL);
+  boolean queue(const char* requestLine, const char* headerBlock,
+    const ResponseFingerprint* fingerprint = NULL, const char* postBody = NULL, JsonStreamExtractor* extractor = NULL);
+  void handle();
+  boolean hasNext();
+  void next();
+  void reset();
+
+  boolean isBusy();
+  boolean isDone();
+  boolean isFailed();
+  int getStatusCode();
+  const char* getStatusLine();
+  String &getBody();
+  boolean isStreamed();
+  String getError();
+
+  boolean isUnchanged(ResponseFingerprint &fingerprint);
+  void clearFingerprint(ResponseFingerprint &fingerprint);
+};
@@ -0,0 +1,114 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "CircuitBreaker.h"
+
+CircuitBreaker::CircuitBreaker(const char* name) {
+  this->name = name;
+}
+
+// true if a request may go out now; moves an expired open circuit to half-open
+boolean CircuitBreaker::allowRequest() {
+  if (state == CIRCUIT_OPEN && millis() - openedAt >= backoff) {
+    state = CIRCUIT_HALF_OPEN;
+    Serial.printf("%s circuit half-open, trying again\n", name);
+  }
+  return state != CIRCUIT_OPEN;
+}
+
+void CircuitBreaker::recordSuccess() {
+  if (state != CIRCUIT_CLOSED) {
+    Serial.printf("%s circuit closed\n", name);
+  }
+  reset();
+}
+
+void CircuitBreaker::recordFailure() {
+  failures++;
+  if (state == CIRCUIT_HALF_OPEN || (state == CIRCUIT_CLOSED && failures >= CIRCUIT_FAILURE_THRESHOLD)) {
+    open();
+  }
+}
+
+void CircuitBreaker::reset() {
+  state = CIRCUIT_CLOSED;
+  failures = 0;
+  opens = 0;
+  backoff = 0;
+  maxedOut = false;
+}
+
+void CircuitBreaker::open() {
+  // double the wait every time, +/- 25% so retries do not line up with the host booting
+  unsigned long wait = CIRCUIT_BACKOFF_BASE;
+  for (int inx = 0; inx < opens && wait < CIRCUIT_BACKOFF_MAX; inx++) {
+    wait *= 2;
+  }
+  if (wait >= CIRCUIT_BACKOFF_MAX) {
+    wait = CIRCUIT_BACKOFF_MAX;
+    maxedOut = true;
+  }
+  backoff = wait - wait / 4 + random(wait / 2);
+  opens++;
+  openedAt = millis();
+  state = CIRCUIT_OPEN;
+  Serial.printf("%s circuit open after %d failures, retry in %lu s\n", name, failures, backoff / 1000);
+}
+
+CircuitState CircuitBreaker::getState() {
+  return state;
+}
+
+String CircuitBreaker::getStateName() {
+  switch (state) {
+    case CIRCUIT_OPEN:
+      return "Open";
+    case CIRCUIT_HALF_OPEN:
+      return "Half-open";
+    default:
+      return "Closed";
+  }
+}
+
+// seconds until an open circuit lets the next request through
+int CircuitBreaker::getRetrySeconds() {
+  if (state != CIRCUIT_OPEN) {
+    return 0;
+  }
+  unsigned long elapsed = millis() - openedAt;
+  if (elapsed >= backoff) {
+    return 0;
+  }
+  return (backoff - elapsed + 999) / 1000;
+}
+
+int CircuitBreaker::getFailures() {
+  return failures;
+}
+
+// true once the host has failed long enough to back off as far as it goes,
+// the point where its last known state is no longer worth showing
+boolean CircuitBreaker::isAtMaxBackoff() {
+  return state != CIRCUIT_CLOSED && maxedOut;
+}
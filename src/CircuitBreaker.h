@@ -0,0 +1,66 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <ESP8266WiFi.h>
+
+#define CIRCUIT_FAILURE_THRESHOLD 3     // consecutive failures before the circuit opens
+#define CIRCUIT_BACKOFF_BASE 15000      // ms the circuit stays open the first time
+#define CIRCUIT_BACKOFF_MAX 600000      // longest wait between retries (10 minutes)
+
+enum CircuitState {
+  CIRCUIT_CLOSED,     // requests go out as usual
+  CIRCUIT_OPEN,       // host is down, no requests until the retry time
+  CIRCUIT_HALF_OPEN   // retry time reached, the next request decides
+};
+
+// Stops a client from hammering a host that keeps failing. After a few
+// failures in a row the circuit opens and requests are refused until a
+// retry time that doubles (with jitter) every time the retry fails too.
+class CircuitBreaker {
+
+private:
+  const char* name;
+  CircuitState state = CIRCUIT_CLOSED;
+  int failures = 0;
+  int opens = 0;
+  unsigned long openedAt = 0;
+  unsigned long backoff = 0;
+  boolean maxedOut = false;   // the last wait was already the longest one
+
+  void open();
+
+public:
+  CircuitBreaker(const char* name);
+  boolean allowRequest();
+  void recordSuccess();
+  void recordFailure();
+  void reset();
+
+  CircuitState getState();
+  String getStateName();
+  int getRetrySeconds();
+  int getFailures();
+  boolean isAtMaxBackoff();
+};
@@ -0,0 +1,144 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "CoopScheduler.h"
+
+// Runs function every interval ms, the first time right away; returns the task id or -1
+int CoopScheduler::every(const char* name, unsigned long interval, CoopTaskFunction function, CoopPriority priority, unsigned long budget) {
+  return add(name, true, interval, function, priority, budget);
+}
+
+// Runs function once, delay ms from now; returns the task id or -1
+int CoopScheduler::once(const char* name, unsigned long delay, CoopTaskFunction function, CoopPriority priority, unsigned long budget) {
+  return add(name, false, delay, function, priority, budget);
+}
+
+int CoopScheduler::add(const char* name, boolean periodic, unsigned long interval, CoopTaskFunction function, CoopPriority priority, unsigned long budget) {
+  int id = 0;
+  while (id < taskCount && tasks[id].active) {
+    id++; // finished one-shot tasks leave their slot free
+  }
+  if (id == COOP_MAX_TASKS) {
+    Serial.printf("No room to schedule task %s\n", name);
+    return -1;
+  }
+  if (id == taskCount) {
+    taskCount++;
+  }
+  CoopTask &task = tasks[id];
+  memset(&task, 0, sizeof(task));
+  task.name = name;
+  task.function = function;
+  task.interval = interval;
+  task.due = periodic ? millis() : millis() + interval;
+  task.budget = budget;
+  task.priority = priority;
+  task.periodic = periodic;
+  task.active = true;
+  return id;
+}
+
+boolean CoopScheduler::isValid(int id) {
+  return id >= 0 && id < taskCount && tasks[id].active;
+}
+
+// Makes the task due on the next run(); a periodic task keeps its interval from there
+void CoopScheduler::runNow(int id) {
+  if (isValid(id)) {
+    tasks[id].due = millis();
+  }
+}
+
+// Also brings the next run forward if it is further away than the new interval
+void CoopScheduler::setInterval(int id, unsigned long interval) {
+  if (!isValid(id)) {
+    return;
+  }
+  CoopTask &task = tasks[id];
+  task.interval = interval;
+  if ((long)(task.due - (millis() + interval)) > 0) {
+    task.due = millis() + interval;
+  }
+}
+
+void CoopScheduler::cancel(int id) {
+  if (isValid(id)) {
+    tasks[id].active = false;
+  }
+}
+
+// Runs every task that is due, the higher priorities first
+void CoopScheduler::run() {
+  for (int priority = COOP_PRIORITY_HIGH; priority <= COOP_PRIORITY_LOW; priority++) {
+    for (uint8_t inx = 0; inx < taskCount; inx++) {
+      CoopTask &task = tasks[inx];
+      if (task.active && task.priority == priority && (long)(millis() - task.due) >= 0) {
+        runTask(task);
+      }
+    }
+  }
+}
+
+void CoopScheduler::runTask(CoopTask &task) {
+  unsigned long started = millis();
+  if ((long)(started - task.due) > COOP_LATE_MARGIN) {
+    task.late++;
+  }
+  // the next deadline is set before the run, so the task may move it itself
+  if (task.periodic) {
+    task.due += task.interval;
+    if ((long)(started - task.due) >= 0) {
+      task.due = started + task.interval; // a whole period behind: skip the missed runs
+    }
+  }
+  task.function();
+  if (!task.periodic) {
+    task.active = false;
+  }
+
+  unsigned long took = millis() - started;
+  task.runs++;
+  if (took > task.longest) {
+    task.longest = took;
+  }
+  if (took > task.budget) {
+    task.overruns++;
+    Serial.printf("Task %s overran its budget: %lu ms of %lu ms\n", task.name, took, task.budget);
+  }
+}
+
+// Logs the tasks that started late or overran since the last report
+void CoopScheduler::report() {
+  for (uint8_t inx = 0; inx < taskCount; inx++) {
+    CoopTask &task = tasks[inx];
+    if (task.late > 0 || task.overruns > 0) {
+      Serial.printf("Task %s: %lu runs, %lu late, %lu overruns, longest %lu ms\n",
+        task.name, task.runs, task.late, task.overruns, task.longest);
+    }
+    task.runs = 0;
+    task.late = 0;
+    task.overruns = 0;
+    task.longest = 0;
+  }
+}
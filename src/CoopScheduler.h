@@ -0,0 +1,81 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <Arduino.h>
+
+#define COOP_MAX_TASKS 10
+#define COOP_LATE_MARGIN 250     // ms past its deadline after which a start counts as late
+#define COOP_DEFAULT_BUDGET 50   // ms a task may run before it counts as an overrun
+
+enum CoopPriority {
+  COOP_PRIORITY_HIGH,
+  COOP_PRIORITY_NORMAL,
+  COOP_PRIORITY_LOW
+};
+
+typedef void (*CoopTaskFunction)();
+
+// Runs the periodic and one-shot jobs of loop() from one place. Deadlines are
+// millis() values compared by their difference, so they are not moved by NTP
+// stepping the clock and survive millis() wrapping. Due tasks run in priority
+// order; a task started well after its deadline counts as late, one running
+// longer than its budget as an overrun, and both are reported.
+class CoopScheduler {
+
+private:
+  struct CoopTask {
+    const char* name;
+    CoopTaskFunction function;
+    unsigned long interval;  // ms
+    unsigned long due;       // millis() of the next run
+    unsigned long budget;    // ms
+    CoopPriority priority;
+    boolean periodic;
+    boolean active;
+    unsigned long runs;
+    unsigned long late;
+    unsigned long overruns;
+    unsigned long longest;   // ms, since the last report
+  };
+
+  CoopTask tasks[COOP_MAX_TASKS];
+  uint8_t taskCount = 0;
+
+  int add(const char* name, boolean periodic, unsigned long interval, CoopTaskFunction function, CoopPriority priority, unsigned long budget);
+  void runTask(CoopTask &task);
+  boolean isValid(int id);
+
+public:
+  int every(const char* name, unsigned long interval, CoopTaskFunction function,
+            CoopPriority priority = COOP_PRIORITY_NORMAL, unsigned long budget = COOP_DEFAULT_BUDGET);
+  int once(const char* name, unsigned long delay, CoopTaskFunction function,
+           CoopPriority priority = COOP_PRIORITY_NORMAL, unsigned long budget = COOP_DEFAULT_BUDGET);
+  void runNow(int id);
+  void setInterval(int id, unsigned long interval);
+  void cancel(int id);
+
+  void run();
+  void report();
+};
@@ -0,0 +1,172 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "DnsCache.h"
+#include <lwip/dns.h>
+
+DnsCache dnsCache;
+
+DnsCache::DnsCache() {
+  for (int inx = 0; inx < DNS_CACHE_SIZE; inx++) {
+    entries[inx].host[0] = '\0';
+    entries[inx].valid = false;
+    entries[inx].pending = false;
+    entries[inx].failed = false;
+    entries[inx].resolvedAt = 0;
+    entries[inx].lastUsed = 0;
+  }
+}
+
+DnsCache::DnsEntry* DnsCache::findEntry(const char* host) {
+  for (int inx = 0; inx < DNS_CACHE_SIZE; inx++) {
+    if (entries[inx].host[0] != '\0' && strcmp(entries[inx].host, host) == 0) {
+      return &entries[inx];
+    }
+  }
+  return NULL;
+}
+
+DnsCache::DnsEntry* DnsCache::newEntry(const char* host) {
+  // prefer an empty slot, otherwise replace the least recently used host
+  DnsEntry* oldest = &entries[0];
+  for (int inx = 0; inx < DNS_CACHE_SIZE; inx++) {
+    if (entries[inx].host[0] == '\0') {
+      oldest = &entries[inx];
+      break;
+    }
+    if ((long)(entries[inx].lastUsed - oldest->lastUsed) < 0) {
+      oldest = &entries[inx];
+    }
+  }
+  strncpy(oldest->host, host, sizeof(oldest->host) - 1);
+  oldest->host[sizeof(oldest->host) - 1] = '\0';
+  oldest->valid = false;
+  oldest->pending = false;
+  oldest->failed = false;
+  return oldest;
+}
+
+// Returns DNS_PENDING while the first lookup of a host is running; call again from loop()
+DnsResult DnsCache::resolve(const char* host, IPAddress &address) {
+  if (address.fromString(host)) {
+    return DNS_RESOLVED; // already an address
+  }
+  DnsEntry* entry = findEntry(host);
+  if (entry == NULL) {
+    entry = newEntry(host);
+  }
+  entry->lastUsed = millis();
+
+  if (entry->valid) {
+    unsigned long age = millis() - entry->resolvedAt;
+    if (age < DNS_CACHE_TTL) {
+      hits++;
+      address = entry->address;
+      return DNS_RESOLVED;
+    }
+    if (age < DNS_CACHE_MAX_STALE) {
+      // stale while revalidate
+      staleHits++;
+      if (!entry->pending) {
+        startLookup(entry);
+      }
+      address = entry->address;
+      return DNS_RESOLVED;
+    }
+    entry->valid = false;
+  }
+
+  if (!entry->pending && !entry->failed) {
+    misses++;
+    startLookup(entry);
+  }
+  if (entry->valid) {
+    address = entry->address; // answered straight from lwIP's own table
+    return DNS_RESOLVED;
+  }
+  if (entry->failed) {
+    entry->failed = false; // reported once, the next call tries again
+    return DNS_FAILED;
+  }
+  return DNS_PENDING;
+}
+
+void DnsCache::startLookup(DnsEntry* entry) {
+  ip_addr_t addr;
+  entry->pending = true;
+  err_t err = dns_gethostbyname(entry->host, &addr, &DnsCache::lookupDone, entry);
+  if (err == ERR_OK) {
+    lookupDone(entry->host, &addr, entry);
+  } else if (err != ERR_INPROGRESS) {
+    lookupDone(entry->host, NULL, entry);
+  }
+}
+
+// Called by lwIP (or directly when the answer was immediate)
+void DnsCache::lookupDone(const char* name, const ip_addr_t* ipaddr, void* arg) {
+  DnsEntry* entry = (DnsEntry*)arg;
+  if (strcmp(entry->host, name) != 0) {
+    return; // the slot was given to another host in the meantime
+  }
+  entry->pending = false;
+  if (ipaddr == NULL) {
+    dnsCache.failures++;
+    Serial.printf("DNS lookup failed: %s\n", name);
+    if (!entry->valid) {
+      entry->failed = true;
+    }
+    return; // a still usable stale address stays in place
+  }
+  entry->address = IPAddress(ip_addr_get_ip4_u32(ipaddr));
+  entry->valid = true;
+  entry->failed = false;
+  entry->resolvedAt = millis();
+}
+
+void DnsCache::flush(const char* host) {
+  DnsEntry* entry = findEntry(host);
+  if (entry != NULL) {
+    entry->valid = false;
+  }
+}
+
+void DnsCache::printStats() {
+  Serial.printf("DNS cache: %lu hits, %lu stale hits, %lu misses, %lu failures\n", hits, staleHits, misses, failures);
+}
+
+unsigned long DnsCache::getHits() {
+  return hits;
+}
+
+unsigned long DnsCache::getStaleHits() {
+  return staleHits;
+}
+
+unsigned long DnsCache::getMisses() {
+  return misses;
+}
+
+unsigned long DnsCache::getFailures() {
+  return failures;
+}
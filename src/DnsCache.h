@@ -0,0 +1,80 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <ESP8266WiFi.h>
+#include <lwip/ip_addr.h>
+
+#define DNS_CACHE_SIZE 4              // printer, weather, time and one spare host
+#define DNS_CACHE_TTL 300000          // ms an address is used before it is refreshed
+#define DNS_CACHE_MAX_STALE 3600000   // ms a stale address may still be served while the refresh fails
+
+enum DnsResult {
+  DNS_RESOLVED,
+  DNS_PENDING,
+  DNS_FAILED
+};
+
+// Hostname -> address cache in front of lwIP's asynchronous resolver, so
+// connecting never waits on the router's DNS. An expired address keeps
+// being served while a refresh runs in the background.
+// lwIP does not hand the record TTL to the callback, so a fixed TTL is used.
+class DnsCache {
+
+private:
+  typedef struct {
+    char host[100];
+    IPAddress address;
+    boolean valid;
+    boolean pending;
+    boolean failed;
+    unsigned long resolvedAt;
+    unsigned long lastUsed;
+  } DnsEntry;
+
+  DnsEntry entries[DNS_CACHE_SIZE];
+
+  unsigned long hits = 0;
+  unsigned long staleHits = 0;
+  unsigned long misses = 0;
+  unsigned long failures = 0;
+
+  DnsEntry* findEntry(const char* host);
+  DnsEntry* newEntry(const char* host);
+  void startLookup(DnsEntry* entry);
+  static void lookupDone(const char* name, const ip_addr_t* ipaddr, void* arg);
+
+public:
+  DnsCache();
+  DnsResult resolve(const char* host, IPAddress &address);
+  void flush(const char* host);
+
+  void printStats();
+  unsigned long getHits();
+  unsigned long getStaleHits();
+  unsigned long getMisses();
+  unsigned long getFailures();
+};
+
+extern DnsCache dnsCache;
@@ -0,0 +1,89 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "DstCache.h"
+
+DstCache::DstCache(Timezone &timezone) {
+  zone = &timezone;
+}
+
+time_t DstCache::toLocal(time_t utc) {
+  if (utc >= validUntil || utc < validFrom) {
+    recalculate(utc);
+  }
+  return utc + offset;
+}
+
+// state of the last converted time
+boolean DstCache::isDST() {
+  return dst;
+}
+
+time_t DstCache::getNextTransition() {
+  return validUntil;
+}
+
+// forget the cached transition, e.g. after the rules changed
+void DstCache::reset() {
+  validFrom = 0;
+  validUntil = 0;
+}
+
+unsigned long DstCache::getRecalculations() {
+  return recalculations;
+}
+
+// Finds the next instant utcIsDST() flips: a day by day scan, then a binary
+// search down to the second. Runs about twice a year.
+void DstCache::recalculate(time_t utc) {
+  recalculations++;
+  dst = zone->utcIsDST(utc);
+  offset = zone->toLocal(utc) - utc;
+  validFrom = utc;
+
+  time_t before = utc;
+  time_t after = 0;
+  for (int days = 1; days <= DST_SEARCH_DAYS; days++) {
+    time_t probe = utc + days * SECS_PER_DAY;
+    if (zone->utcIsDST(probe) != dst) {
+      after = probe;
+      break;
+    }
+    before = probe;
+  }
+  if (after == 0) {
+    validUntil = utc + DST_SEARCH_DAYS * SECS_PER_DAY; // no DST in this zone, look again next year
+  } else {
+    while (after - before > 1) {
+      time_t middle = before + (after - before) / 2;
+      if (zone->utcIsDST(middle) == dst) {
+        before = middle;
+      } else {
+        after = middle;
+      }
+    }
+    validUntil = after;
+  }
+  Serial.printf("DST %s, offset %ld s, next change at %ld\n", dst ? "active" : "inactive", (long)offset, (long)validUntil);
+}
@@ -0,0 +1,52 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <Timezone.h>    // https://github.com/JChristensen/Timezone
+
+#define DST_SEARCH_DAYS 366   // how far ahead the next transition is looked for
+
+// Remembers the current UTC offset of a Timezone and the instant it next
+// changes, so converting to local time is an add and a compare until the
+// next DST transition instead of the rule arithmetic on every call.
+class DstCache {
+
+private:
+  Timezone* zone;
+  boolean dst = false;
+  long offset = 0;            // local - utc in seconds
+  time_t validFrom = 0;
+  time_t validUntil = 0;      // next DST transition (UTC)
+  unsigned long recalculations = 0;
+
+  void recalculate(time_t utc);
+
+public:
+  DstCache(Timezone &timezone);
+  time_t toLocal(time_t utc);
+  boolean isDST();
+  time_t getNextTransition();
+  void reset();
+  unsigned long getRecalculations();
+};
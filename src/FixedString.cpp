@@ -0,0 +1,129 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "FixedString.h"
+
+unsigned long FixedStringBase::truncations = 0;
+
+FixedStringBase::FixedStringBase(char* storage, uint16_t capacity) {
+  text = storage;
+  this->capacity = capacity;
+  text[0] = '\0';
+}
+
+void FixedStringBase::assign(const char* value) {
+  used = 0;
+  append(value);
+}
+
+void FixedStringBase::assign(const char* value, size_t length) {
+  used = 0;
+  append(value, length);
+}
+
+void FixedStringBase::append(const char* value) {
+  append(value, value == NULL ? 0 : strlen(value));
+}
+
+void FixedStringBase::append(const char* value, size_t length) {
+  if (length > (size_t)(capacity - used)) {
+    truncations++;
+    length = capacity - used;
+  }
+  memmove(text + used, value, length); // value may be part of this string
+  used += length;
+  text[used] = '\0';
+}
+
+void FixedStringBase::append(char c) {
+  append(&c, 1);
+}
+
+void FixedStringBase::append(long value) {
+  char digits[12];
+  append(digits, sprintf(digits, "%ld", value));
+}
+
+void FixedStringBase::clear() {
+  used = 0;
+  text[0] = '\0';
+}
+
+// Drops leading and trailing white space, like String::trim()
+void FixedStringBase::trim() {
+  size_t start = 0;
+  while (start < used && isspace(text[start])) {
+    start++;
+  }
+  while (used > start && isspace(text[used - 1])) {
+    used--;
+  }
+  used -= start;
+  memmove(text, text + start, used);
+  text[used] = '\0';
+}
+
+const char* FixedStringBase::c_str() const {
+  return text;
+}
+
+size_t FixedStringBase::length() const {
+  return used;
+}
+
+size_t FixedStringBase::getCapacity() const {
+  return capacity;
+}
+
+boolean FixedStringBase::isEmpty() const {
+  return used == 0;
+}
+
+boolean FixedStringBase::equals(const char* value) const {
+  return strcmp(text, value == NULL ? "" : value) == 0;
+}
+
+int FixedStringBase::indexOf(char c, int from) const {
+  if (from < 0 || from >= used) {
+    return -1;
+  }
+  const char* found = strchr(text + from, c);
+  return found == NULL ? -1 : found - text;
+}
+
+int FixedStringBase::indexOf(const char* value, int from) const {
+  if (from < 0 || from > used) {
+    return -1;
+  }
+  const char* found = strstr(text + from, value);
+  return found == NULL ? -1 : found - text;
+}
+
+long FixedStringBase::toInt() const {
+  return atol(text);
+}
+
+unsigned long FixedStringBase::getTruncations() {
+  return truncations;
+}
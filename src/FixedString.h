@@ -0,0 +1,99 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <Arduino.h>
+
+// Text with a fixed capacity kept inline, for values that live as long as
+// their owner: settings, API keys, error messages. Unlike String it never
+// touches the heap; text that does not fit is cut and counted.
+class FixedStringBase {
+
+private:
+  char* text;
+  uint16_t capacity; // characters, not counting the '\0'
+  uint16_t used = 0;
+  static unsigned long truncations;
+
+protected:
+  FixedStringBase(char* storage, uint16_t capacity);
+
+public:
+  // text points into the derived object, a copy would share the other one's storage
+  FixedStringBase(const FixedStringBase&) = delete;
+  FixedStringBase& operator=(const FixedStringBase&) = delete;
+
+  void assign(const char* value);
+  void assign(const char* value, size_t length);
+  void append(const char* value);
+  void append(const char* value, size_t length);
+  void append(char c);
+  void append(long value);
+  void clear();
+  void trim();
+
+  const char* c_str() const;
+  size_t length() const;
+  size_t getCapacity() const;
+  boolean isEmpty() const;
+  boolean equals(const char* value) const;
+  int indexOf(char c, int from = 0) const;
+  int indexOf(const char* value, int from = 0) const;
+  long toInt() const;
+
+  FixedStringBase& operator+=(const char* value) { append(value); return *this; }
+  FixedStringBase& operator+=(const String& value) { append(value.c_str(), value.length()); return *this; }
+  FixedStringBase& operator+=(const FixedStringBase& value) { append(value.text, value.used); return *this; }
+  FixedStringBase& operator+=(char c) { append(c); return *this; }
+  FixedStringBase& operator+=(int value) { append((long)value); return *this; }
+  FixedStringBase& operator+=(long value) { append(value); return *this; }
+  boolean operator==(const char* value) const { return equals(value); }
+  boolean operator==(const String& value) const { return equals(value.c_str()); }
+  boolean operator==(const FixedStringBase& value) const { return equals(value.text); }
+  boolean operator!=(const char* value) const { return !equals(value); }
+  boolean operator!=(const String& value) const { return !equals(value.c_str()); }
+  boolean operator!=(const FixedStringBase& value) const { return !equals(value.text); }
+
+  static unsigned long getTruncations();
+};
+
+// N is the number of characters it can hold
+template <size_t N>
+class FixedString : public FixedStringBase {
+
+private:
+  char storage[N + 1];
+
+public:
+  FixedString() : FixedStringBase(storage, N) {}
+  FixedString(const char* value) : FixedString() { assign(value); }
+  // copies point text at their own storage and take the characters over
+  FixedString(const FixedString& value) : FixedString() { assign(value.c_str(), value.length()); }
+  FixedString(const FixedStringBase& value) : FixedString() { assign(value.c_str(), value.length()); }
+
+  FixedString& operator=(const FixedString& value) { assign(value.c_str(), value.length()); return *this; }
+  FixedString& operator=(const FixedStringBase& value) { assign(value.c_str(), value.length()); return *this; }
+  FixedString& operator=(const char* value) { assign(value); return *this; }
+  FixedString& operator=(const String& value) { assign(value.c_str(), value.length()); return *this; }
+};
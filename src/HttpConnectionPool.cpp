@@ -0,0 +1,220 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "HttpConnectionPool.h"
+
+HttpConnectionPool connectionPool;
+
+HttpConnectionPool::HttpConnectionPool() {
+  for (int inx = 0; inx < HTTP_POOL_SIZE; inx++) {
+    entries[inx].host[0] = '\0';
+    entries[inx].port = 0;
+    entries[inx].inUse = false;
+    entries[inx].probed = false;
+    entries[inx].lastUsed = 0;
+  }
+}
+
+HttpConnectionPool::PoolEntry* HttpConnectionPool::findEntry(const char* host, int port) {
+  for (int inx = 0; inx < HTTP_POOL_SIZE; inx++) {
+    if (!entries[inx].inUse && entries[inx].port == port && strcmp(entries[inx].host, host) == 0) {
+      return &entries[inx];
+    }
+  }
+  return NULL;
+}
+
+HttpConnectionPool::PoolEntry* HttpConnectionPool::findFreeEntry() {
+  // prefer an empty slot, otherwise evict the least recently used idle connection
+  PoolEntry* oldest = NULL;
+  for (int inx = 0; inx < HTTP_POOL_SIZE; inx++) {
+    if (entries[inx].inUse) {
+      continue;
+    }
+    if (entries[inx].host[0] == '\0') {
+      return &entries[inx];
+    }
+    if (oldest == NULL || (long)(entries[inx].lastUsed - oldest->lastUsed) < 0) {
+      oldest = &entries[inx];
+    }
+  }
+  return oldest;
+}
+
+// address is only used when a new connection has to be opened
+WiFiClient* HttpConnectionPool::acquire(const char* host, IPAddress address, int port, unsigned long timeout) {
+  lastReused = false;
+  requests++;
+
+  PoolEntry* entry = findEntry(host, port);
+  if (entry != NULL) {
+    if (entry->client.connected() && millis() - entry->lastUsed < HTTP_POOL_IDLE_TIMEOUT) {
+      // throw away anything the server sent after the previous response
+      while (entry->client.available()) {
+        entry->client.read();
+      }
+      entry->client.setTimeout(timeout);
+      entry->inUse = true;
+      if (entry->probed) {
+        // the handshake was counted by prepare(), this request is its first user
+        entry->probed = false;
+        return &entry->client;
+      }
+      lastReused = true;
+      reused++;
+      return &entry->client;
+    }
+    entry->client.stop();
+  } else {
+    entry = findFreeEntry();
+    if (entry == NULL) {
+      Serial.println("Connection pool exhausted");
+      return NULL;
+    }
+    entry->client.stop();
+  }
+
+  entry->host[0] = '\0';
+  entry->probed = false;
+  entry->client.setTimeout(timeout);
+  if (!entry->client.connect(address, port)) {
+    entry->client.stop();
+    return NULL;
+  }
+  handshakes++;
+  strncpy(entry->host, host, sizeof(entry->host) - 1);
+  entry->host[sizeof(entry->host) - 1] = '\0';
+  entry->port = port;
+  entry->inUse = true;
+  return &entry->client;
+}
+
+void HttpConnectionPool::release(WiFiClient* client, boolean keepAlive) {
+  for (int inx = 0; inx < HTTP_POOL_SIZE; inx++) {
+    if (&entries[inx].client == client) {
+      entries[inx].inUse = false;
+      entries[inx].lastUsed = millis();
+      if (!keepAlive) {
+        entries[inx].client.stop();
+        entries[inx].host[0] = '\0';
+      }
+      return;
+    }
+  }
+}
+
+// Makes sure an idle connection to host:port is waiting for the next acquire();
+// false if the server did not accept one within timeout
+boolean HttpConnectionPool::prepare(const char* host, IPAddress address, int port, unsigned long timeout) {
+  PoolEntry* entry = findEntry(host, port);
+  if (entry != NULL && entry->client.connected() && millis() - entry->lastUsed < HTTP_POOL_IDLE_TIMEOUT) {
+    return true;
+  }
+  if (entry == NULL) {
+    entry = findFreeEntry();
+    if (entry == NULL) {
+      return true; // nothing to probe with, let the request find out
+    }
+  }
+  entry->client.stop();
+  entry->host[0] = '\0';
+  entry->client.setTimeout(timeout);
+  if (!entry->client.connect(address, port)) {
+    entry->client.stop();
+    return false;
+  }
+  handshakes++;
+  strncpy(entry->host, host, sizeof(entry->host) - 1);
+  entry->host[sizeof(entry->host) - 1] = '\0';
+  entry->port = port;
+  entry->probed = true;
+  entry->lastUsed = millis();
+  return true;
+}
+
+void HttpConnectionPool::close(const char* host, int port) {
+  for (int inx = 0; inx < HTTP_POOL_SIZE; inx++) {
+    if (entries[inx].port == port && strcmp(entries[inx].host, host) == 0) {
+      entries[inx].client.stop();
+      entries[inx].host[0] = '\0';
+      entries[inx].inUse = false;
+    }
+  }
+}
+
+boolean HttpConnectionPool::isLastReused() {
+  return lastReused;
+}
+
+void HttpConnectionPool::recordLatency(boolean reusedConnection, unsigned long elapsed) {
+  if (reusedConnection) {
+    latencyReusedTotal += elapsed;
+    latencyReusedCount++;
+  } else {
+    latencyNewTotal += elapsed;
+    latencyNewCount++;
+  }
+}
+
+void HttpConnectionPool::recordSkippedParse() {
+  skippedParses++;
+}
+
+void HttpConnectionPool::recordWrite() {
+  writes++;
+}
+
+void HttpConnectionPool::printStats() {
+  Serial.printf("Connection pool: %lu requests in %lu writes, %lu handshakes, %lu saved | avg latency new %lu ms, reused %lu ms | %lu unchanged responses not parsed\n",
+    requests, writes, handshakes, getHandshakesSaved(), getAverageLatencyNew(), getAverageLatencyReused(), skippedParses);
+}
+
+unsigned long HttpConnectionPool::getRequests() {
+  return requests;
+}
+
+unsigned long HttpConnectionPool::getHandshakes() {
+  return handshakes;
+}
+
+unsigned long HttpConnectionPool::getHandshakesSaved() {
+  return reused;
+}
+
+unsigned long HttpConnectionPool::getAverageLatencyNew() {
+  if (latencyNewCount == 0) {
+    return 0;
+  }
+  return latencyNewTotal / latencyNewCount;
+}
+
+unsigned long HttpConnectionPool::getAverageLatencyReused() {
+  if (latencyReusedCount == 0) {
+    return 0;
+  }
+  return latencyReusedTotal / latencyReusedCount;
+}
+
+unsigned long HttpConnectionPool::getSkippedParses() {
+  return skippedParses;
+}
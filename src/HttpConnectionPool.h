@@ -0,0 +1,80 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+#include <ESP8266WiFi.h>
+
+#define HTTP_POOL_SIZE 3                // one slot per server:port we talk to
+#define HTTP_POOL_IDLE_TIMEOUT 300000   // drop idle keep-alive connections after 5 minutes
+
+// Keeps HTTP/1.1 keep-alive connections open between requests so repeated
+// polls of the same server:port do not pay a TCP handshake every time.
+class HttpConnectionPool {
+
+private:
+  typedef struct {
+    char host[100];
+    int port;
+    WiFiClient client;
+    boolean inUse;
+    boolean probed;   // opened by prepare(), not yet used by a request
+    unsigned long lastUsed;
+  } PoolEntry;
+
+  PoolEntry entries[HTTP_POOL_SIZE];
+
+  boolean lastReused = false;
+  unsigned long requests = 0;
+  unsigned long handshakes = 0;
+  unsigned long reused = 0;
+  unsigned long latencyNewTotal = 0;
+  unsigned long latencyNewCount = 0;
+  unsigned long latencyReusedTotal = 0;
+  unsigned long latencyReusedCount = 0;
+  unsigned long skippedParses = 0;
+  unsigned long writes = 0;
+
+  PoolEntry* findEntry(const char* host, int port);
+  PoolEntry* findFreeEntry();
+
+public:
+  HttpConnectionPool();
+  WiFiClient* acquire(const char* host, IPAddress address, int port, unsigned long timeout);
+  void release(WiFiClient* client, boolean keepAlive);
+  boolean prepare(const char* host, IPAddress address, int port, unsigned long timeout);
+  void close(const char* host, int port);
+  boolean isLastReused();
+
+  void recordLatency(boolean reusedConnection, unsigned long elapsed);
+  void recordSkippedParse();
+  void recordWrite();
+  void printStats();
+  unsigned long getRequests();
+  unsigned long getHandshakes();
+  unsigned long getHandshakesSaved();
+  unsigned long getAverageLatencyNew();
+  unsigned long getAverageLatencyReused();
+  unsigned long getSkippedParses();
+};
+
+extern HttpConnectionPool connectionPool;
@@ -0,0 +1,117 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "JsonBufferPool.h"
+
+JsonBufferPool jsonBufferPool;
+
+// static, so the arenas never come from the heap
+static uint32_t smallArena[JSON_POOL_SMALL_SIZE / 4];
+static uint32_t mediumArena[JSON_POOL_MEDIUM_SIZE / 4];
+#if defined(PRINTER_MON)
+static uint32_t largeArena[JSON_POOL_LARGE_SIZE / 4];
+#endif
+
+JsonBufferPool::JsonBufferPool() {
+#if defined(PRINTER_MON)
+  char* memory[JSON_POOL_CLASSES] = { (char*)smallArena, (char*)mediumArena, (char*)largeArena };
+  size_t capacity[JSON_POOL_CLASSES] = { sizeof(smallArena), sizeof(mediumArena), sizeof(largeArena) };
+#else
+  char* memory[JSON_POOL_CLASSES] = { (char*)smallArena, (char*)mediumArena };
+  size_t capacity[JSON_POOL_CLASSES] = { sizeof(smallArena), sizeof(mediumArena) };
+#endif
+  for (int inx = 0; inx < JSON_POOL_CLASSES; inx++) {
+    arenas[inx].memory = memory[inx];
+    arenas[inx].capacity = capacity[inx];
+    arenas[inx].inUse = false;
+    arenas[inx].peak = 0;
+    arenas[inx].peakText = 0;
+    arenas[inx].borrows = 0;
+  }
+}
+
+// The smallest free arena that should fit, else the largest free one; NULL if all are in use
+JsonBufferPool::Arena* JsonBufferPool::acquire(size_t textLength) {
+  size_t needed = textLength * JSON_POOL_TEXT_PERCENT / 100;
+  Arena* largest = NULL;
+  for (int inx = 0; inx < JSON_POOL_CLASSES; inx++) {
+    if (arenas[inx].inUse) {
+      continue;
+    }
+    if (arenas[inx].capacity >= needed) {
+      arenas[inx].inUse = true;
+      arenas[inx].borrows++;
+      return &arenas[inx];
+    }
+    largest = &arenas[inx];
+  }
+  shortBorrows++; // shown with the peaks
+  if (largest != NULL) {
+    largest->inUse = true;
+    largest->borrows++;
+  }
+  return largest;
+}
+
+void JsonBufferPool::release(Arena* arena, size_t used, size_t textLength) {
+  if (arena == NULL) {
+    return;
+  }
+  arena->inUse = false;
+  if (used > arena->peak) {
+    arena->peak = used;
+    arena->peakText = textLength;
+    printStats();
+  }
+}
+
+void JsonBufferPool::printStats() {
+  Serial.print("JSON pool peaks:");
+  for (int inx = 0; inx < JSON_POOL_CLASSES; inx++) {
+    Serial.printf(" %u/%u bytes (%u bytes of text, %lu borrows)", (unsigned)arenas[inx].peak, (unsigned)arenas[inx].capacity,
+      (unsigned)arenas[inx].peakText, arenas[inx].borrows);
+  }
+  Serial.printf(" | %lu too small\n", shortBorrows);
+}
+
+size_t JsonBufferPool::getPeak(int sizeClass) {
+  return arenas[sizeClass].peak;
+}
+
+unsigned long JsonBufferPool::getShortBorrows() {
+  return shortBorrows;
+}
+
+PooledJsonBuffer::PooledJsonBuffer(size_t textLength) : PooledJsonBuffer(jsonBufferPool.acquire(textLength), textLength) {
+}
+
+PooledJsonBuffer::PooledJsonBuffer(JsonBufferPool::Arena* arena, size_t textLength)
+    : ArduinoJson::Internals::StaticJsonBufferBase(arena != NULL ? arena->memory : NULL, arena != NULL ? arena->capacity : 0) {
+  this->arena = arena;
+  this->textLength = textLength;
+}
+
+PooledJsonBuffer::~PooledJsonBuffer() {
+  jsonBufferPool.release(arena, size(), textLength);
+}
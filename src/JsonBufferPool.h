@@ -0,0 +1,88 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <Arduino.h>
+#include "libs/ArduinoJson/ArduinoJson.h"
+
+// Arena sizes in bytes, one arena per size class; see the peaks logged by the pool to tune them
+#define JSON_POOL_SMALL_SIZE 1024
+#define JSON_POOL_MEDIUM_SIZE 2048
+#if defined(PRINTER_MON)
+#define JSON_POOL_LARGE_SIZE 4096   // printer push messages; a weather response fits the medium arena
+#define JSON_POOL_CLASSES 3
+#else
+#define JSON_POOL_CLASSES 2
+#endif
+// Arena bytes asked for per 100 bytes of JSON text. Parsed in place the strings stay in
+// the text and only the nodes (16 bytes per member or element) come from the arena;
+// OctoPrint push messages need 100-150, so a 2 KB "current" message fits the large arena.
+#define JSON_POOL_TEXT_PERCENT 150
+
+// Preallocated parse arenas shared by all clients, so parsing a response or
+// push message does not allocate and free a DynamicJsonBuffer on the heap.
+// Borrowed through PooledJsonBuffer, which hands its arena back when it goes out of scope.
+class JsonBufferPool {
+
+private:
+  typedef struct {
+    char* memory;
+    size_t capacity;
+    boolean inUse;
+    size_t peak;          // most bytes ever used in this arena
+    size_t peakText;      // length of the text that used them
+    unsigned long borrows;
+  } Arena;
+
+  Arena arenas[JSON_POOL_CLASSES];
+  unsigned long shortBorrows = 0;   // no free arena was big enough
+
+  Arena* acquire(size_t textLength);
+  void release(Arena* arena, size_t used, size_t textLength);
+
+  friend class PooledJsonBuffer;
+
+public:
+  JsonBufferPool();
+  void printStats();
+  size_t getPeak(int sizeClass);
+  unsigned long getShortBorrows();
+};
+
+extern JsonBufferPool jsonBufferPool;
+
+// A StaticJsonBuffer over a borrowed arena. Size it with the length of the
+// text and parse that text in place (parseObject(text.begin())).
+class PooledJsonBuffer : public ArduinoJson::Internals::StaticJsonBufferBase {
+
+private:
+  JsonBufferPool::Arena* arena;
+  size_t textLength;
+
+  PooledJsonBuffer(JsonBufferPool::Arena* arena, size_t textLength);
+
+public:
+  PooledJsonBuffer(size_t textLength);
+  ~PooledJsonBuffer();
+};
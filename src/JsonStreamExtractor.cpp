@@ -0,0 +1,334 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "JsonStreamExtractor.h"
+
+JsonStreamExtractor::JsonStreamExtractor(const JsonPath* paths, uint8_t pathCount, JsonValueHandler handler, void* context) {
+  this->paths = paths;
+  this->pathCount = min(pathCount, (uint8_t)JSON_STREAM_MAX_PATHS);
+  this->handler = handler;
+  this->context = context;
+  begin();
+}
+
+// Ready for a new document
+void JsonStreamExtractor::begin() {
+  state = EXPECT_VALUE;
+  escaped = false;
+  unicodeDigits = 0;
+  depth = 0;
+  arrays = 0;
+  seen = 0;
+  keyLength = 0;
+  valueLength = 0;
+  valueMask = pathCount == JSON_STREAM_MAX_PATHS ? 0xFFFFFFFFUL : (1UL << pathCount) - 1;
+  masks[0] = valueMask;
+}
+
+// The key "$" stands for in the paths, e.g. a printer name picked at run time
+void JsonStreamExtractor::setKey(const char* key) {
+  strncpy(runtimeKey, key, JSON_STREAM_KEY_SIZE - 1);
+  runtimeKey[JSON_STREAM_KEY_SIZE - 1] = '\0';
+}
+
+void JsonStreamExtractor::feed(const char* data, size_t length) {
+  for (size_t inx = 0; inx < length && state != PARSE_ERROR; inx++) {
+    parse(data[inx]);
+  }
+}
+
+// True if a whole document was read. Paths that were not in it are handed to
+// the handler as "", the same as a missing member of a parsed object.
+boolean JsonStreamExtractor::finish() {
+  if (state != PARSE_DONE) {
+    return false;
+  }
+  for (uint8_t inx = 0; inx < pathCount; inx++) {
+    if (!(seen & (1UL << inx))) {
+      handler(context, paths[inx].field, "");
+    }
+  }
+  return true;
+}
+
+boolean JsonStreamExtractor::isFailed() {
+  return state == PARSE_ERROR;
+}
+
+void JsonStreamExtractor::parse(char c) {
+  switch (state) {
+    case IN_STRING:
+    case IN_KEY:
+      if (unicodeDigits > 0) {
+        // \uXXXX: only ASCII is kept, anything else becomes '?'
+        int digit = isdigit(c) ? c - '0' : (toupper(c) >= 'A' && toupper(c) <= 'F') ? toupper(c) - 'A' + 10 : -1;
+        if (digit < 0) {
+          state = PARSE_ERROR;
+          return;
+        }
+        unicodeValue = (unicodeValue << 4) | digit;
+        unicodeDigits--;
+        if (unicodeDigits == 0) {
+          appendChar(unicodeValue < 0x80 ? (char)unicodeValue : '?');
+        }
+        return;
+      }
+      if (escaped) {
+        escaped = false;
+        switch (c) {
+          case 'n': appendChar('\n'); break;
+          case 't': appendChar('\t'); break;
+          case 'r': appendChar('\r'); break;
+          case 'b': appendChar('\b'); break;
+          case 'f': appendChar('\f'); break;
+          case 'u': unicodeDigits = 4; unicodeValue = 0; break;
+          default: appendChar(c); break;
+        }
+        return;
+      }
+      if (c == '\\') {
+        escaped = true;
+      } else if (c != '"') {
+        appendChar(c);
+      } else if (state == IN_KEY) {
+        matchKey();
+        state = EXPECT_COLON;
+      } else {
+        emit();
+        valueDone();
+      }
+      return;
+    case IN_LITERAL:
+      if (c == ',' || c == '}' || c == ']' || isspace(c)) {
+        emit();
+        valueDone();
+        parse(c);
+      } else {
+        appendChar(c);
+      }
+      return;
+    default:
+      break;
+  }
+
+  if (isspace(c)) {
+    return;
+  }
+  switch (state) {
+    case EXPECT_VALUE:
+      if (c == ']' && depth > 0 && (arrays & (1UL << depth))) {
+        pop(); // empty array
+      } else {
+        startValue(c);
+      }
+      break;
+    case EXPECT_KEY:
+      if (c == '"') {
+        keyLength = 0;
+        keyTooLong = false;
+        state = IN_KEY;
+      } else if (c == '}') {
+        pop(); // empty object
+      } else {
+        state = PARSE_ERROR;
+      }
+      break;
+    case EXPECT_COLON:
+      state = (c == ':') ? EXPECT_VALUE : PARSE_ERROR;
+      break;
+    case EXPECT_NEXT:
+      if (c == ',') {
+        if (arrays & (1UL << depth)) {
+          indexes[depth]++;
+          matchElement();
+          state = EXPECT_VALUE;
+        } else {
+          state = EXPECT_KEY;
+        }
+      } else if (c == ((arrays & (1UL << depth)) ? ']' : '}')) {
+        pop(); // closes the container it belongs to, "[1}" is rejected
+      } else {
+        state = PARSE_ERROR;
+      }
+      break;
+    case PARSE_DONE:
+      break; // trailing bytes after the document
+    default:
+      state = PARSE_ERROR;
+      break;
+  }
+}
+
+void JsonStreamExtractor::startValue(char c) {
+  valueLength = 0;
+  if (c == '{') {
+    if (push(false)) {
+      state = EXPECT_KEY;
+    }
+  } else if (c == '[') {
+    if (push(true)) {
+      indexes[depth] = 0;
+      matchElement();
+      state = EXPECT_VALUE;
+    }
+  } else if (c == '"') {
+    state = IN_STRING;
+  } else if (isdigit(c) || c == '-' || c == 't' || c == 'f' || c == 'n') {
+    state = IN_LITERAL;
+    appendChar(c);
+  } else {
+    state = PARSE_ERROR; // a bracket or separator where a value belongs
+  }
+}
+
+void JsonStreamExtractor::appendChar(char c) {
+  if (state == IN_KEY) {
+    if (keyLength < JSON_STREAM_KEY_SIZE - 1) {
+      key[keyLength++] = c;
+    } else {
+      keyTooLong = true;
+    }
+  } else if (valueMask != 0 && valueLength < JSON_STREAM_VALUE_SIZE - 1) {
+    value[valueLength++] = c; // values nobody asked for are not kept
+  }
+}
+
+void JsonStreamExtractor::matchKey() {
+  if (keyTooLong) {
+    valueMask = 0;
+    return;
+  }
+  matchSegment(key, keyLength);
+}
+
+void JsonStreamExtractor::matchElement() {
+  char text[6];
+  matchSegment(text, sprintf(text, "%u", indexes[depth]));
+}
+
+// Narrows the paths of the current container down to the ones continuing with this key or index
+void JsonStreamExtractor::matchSegment(const char* text, size_t length) {
+  valueMask = 0;
+  uint32_t candidates = masks[depth];
+  for (uint8_t inx = 0; candidates != 0; inx++, candidates >>= 1) {
+    if ((candidates & 1) && segmentMatches(paths[inx].path, depth - 1, text, length)) {
+      valueMask |= 1UL << inx;
+    }
+  }
+}
+
+void JsonStreamExtractor::emit() {
+  if (valueMask == 0) {
+    return;
+  }
+  value[valueLength] = '\0';
+  if (state == IN_LITERAL && strcmp(value, "null") == 0) {
+    value[0] = '\0';
+  }
+  uint32_t candidates = valueMask;
+  for (uint8_t inx = 0; candidates != 0; inx++, candidates >>= 1) {
+    if ((candidates & 1) && countSegments(paths[inx].path) == depth) {
+      seen |= 1UL << inx;
+      handler(context, paths[inx].field, value);
+    }
+  }
+}
+
+// False, and the document rejected, if it nests deeper than JSON_STREAM_MAX_DEPTH
+boolean JsonStreamExtractor::push(boolean isArray) {
+  if (depth >= JSON_STREAM_MAX_DEPTH) {
+    state = PARSE_ERROR;
+    return false;
+  }
+  depth++;
+  // keep the paths that go deeper than this container, and the ones ending at it
+  uint32_t deeper = 0;
+  uint32_t ending = 0;
+  uint32_t candidates = valueMask;
+  for (uint8_t inx = 0; candidates != 0; inx++, candidates >>= 1) {
+    if (candidates & 1) {
+      int segments = countSegments(paths[inx].path);
+      if (segments >= depth) {
+        deeper |= 1UL << inx;
+      } else if (segments == depth - 1) {
+        ending |= 1UL << inx;
+      }
+    }
+  }
+  masks[depth] = deeper;
+  ends[depth] = ending;
+  if (isArray) {
+    arrays |= 1UL << depth;
+  } else {
+    arrays &= ~(1UL << depth);
+  }
+  return true;
+}
+
+void JsonStreamExtractor::pop() {
+  uint32_t candidates = ends[depth];
+  for (uint8_t inx = 0; candidates != 0; inx++, candidates >>= 1) {
+    if (candidates & 1) {
+      seen |= 1UL << inx;
+      handler(context, paths[inx].field, "");
+    }
+  }
+  depth--;
+  valueDone();
+}
+
+void JsonStreamExtractor::valueDone() {
+  valueMask = 0;
+  state = (depth == 0) ? PARSE_DONE : EXPECT_NEXT;
+}
+
+int JsonStreamExtractor::countSegments(const char* path) {
+  int count = 1;
+  for (const char* c = path; *c != '\0'; c++) {
+    if (*c == '.') {
+      count++;
+    }
+  }
+  return count;
+}
+
+// Compares the index'th '.' separated key of path with text
+boolean JsonStreamExtractor::segmentMatches(const char* path, int index, const char* text, size_t length) {
+  const char* segment = path;
+  for (int inx = 0; inx < index; inx++) {
+    segment = strchr(segment, '.');
+    if (segment == NULL) {
+      return false;
+    }
+    segment++;
+  }
+  size_t segmentLength = strcspn(segment, ".");
+  if (segmentLength == 1 && segment[0] == '*') {
+    return true;
+  }
+  if (segmentLength == 1 && segment[0] == '$') {
+    return strlen(runtimeKey) == length && strncmp(runtimeKey, text, length) == 0;
+  }
+  return segmentLength == length && strncmp(segment, text, length) == 0;
+}
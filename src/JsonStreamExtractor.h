@@ -0,0 +1,108 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <Arduino.h>
+
+#define JSON_STREAM_MAX_DEPTH 8      // deepest nesting followed, deeper documents are rejected
+#define JSON_STREAM_MAX_PATHS 32     // paths per table, one bit each
+#define JSON_STREAM_KEY_SIZE 32      // longer keys never match a path
+#define JSON_STREAM_VALUE_SIZE 96    // longer values are cut
+
+// One value to pick out of a document: keys joined by '.', e.g. "job.file.name",
+// and the field number the handler is called with. Array elements are matched by
+// their index ("extruder.0.tempRead"), "*" matches any key or element and "$" the
+// key given to setKey(). A path ending at an object or array is reported as ""
+// when that container closes, e.g. "*" for each element of a top level array.
+typedef struct {
+  const char* path;
+  uint8_t field;
+} JsonPath;
+
+// Called with every matching value: strings unescaped, numbers and booleans as
+// their text, null as "". Paths that never showed up are reported as "" by finish().
+typedef void (*JsonValueHandler)(void* context, uint8_t field, const char* value);
+
+// Streaming JSON reader driven by a table of key paths. Bytes are fed as they
+// arrive and matching values go straight to the handler; no document tree is
+// built, so memory use does not depend on the size of the response.
+class JsonStreamExtractor {
+
+private:
+  enum ParseState {
+    EXPECT_VALUE,
+    EXPECT_KEY,
+    EXPECT_COLON,
+    EXPECT_NEXT,
+    IN_KEY,
+    IN_STRING,
+    IN_LITERAL,
+    PARSE_DONE,
+    PARSE_ERROR
+  };
+
+  const JsonPath* paths;
+  uint8_t pathCount;
+  JsonValueHandler handler;
+  void* context;
+
+  ParseState state = EXPECT_VALUE;
+  boolean escaped = false;
+  int unicodeDigits = 0;
+  unsigned int unicodeValue = 0;
+  int depth = 0;
+  uint32_t arrays = 0;                           // bit per depth, set for arrays
+  uint32_t masks[JSON_STREAM_MAX_DEPTH + 1];     // paths still matching at each depth
+  uint32_t ends[JSON_STREAM_MAX_DEPTH + 1];      // paths ending at the container at each depth
+  uint16_t indexes[JSON_STREAM_MAX_DEPTH + 1];   // current element of arrays
+  uint32_t valueMask = 0;                        // paths matching the value being read
+  uint32_t seen = 0;
+  char key[JSON_STREAM_KEY_SIZE];
+  size_t keyLength = 0;
+  boolean keyTooLong = false;
+  char value[JSON_STREAM_VALUE_SIZE];
+  size_t valueLength = 0;
+  char runtimeKey[JSON_STREAM_KEY_SIZE] = "";
+
+  void parse(char c);
+  void startValue(char c);
+  void appendChar(char c);
+  void matchKey();
+  void matchElement();
+  void matchSegment(const char* text, size_t length);
+  void emit();
+  boolean push(boolean isArray);
+  void pop();
+  void valueDone();
+  static int countSegments(const char* path);
+  boolean segmentMatches(const char* path, int index, const char* text, size_t length);
+
+public:
+  JsonStreamExtractor(const JsonPath* paths, uint8_t pathCount, JsonValueHandler handler, void* context);
+  void begin();
+  void setKey(const char* key);
+  void feed(const char* data, size_t length);
+  boolean finish();
+  boolean isFailed();
+};
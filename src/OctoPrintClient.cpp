@@ -26,293 +26,542 @@ SOFTWARE.
 
 #include "OctoPrintClient.h"
 
-OctoPrintClient::OctoPrintClient(String ApiKey, String server, int port, String user, String pass, boolean psu) {
+// The values read from each endpoint, everything else in the responses is skipped
+const JsonPath OctoPrintClient::JOB_PATHS[] = {
+  {"job.averagePrintTime", JOB_AVERAGE_PRINT_TIME},
+  {"job.estimatedPrintTime", JOB_ESTIMATED_PRINT_TIME},
+  {"job.file.name", JOB_FILE_NAME},
+  {"job.file.size", JOB_FILE_SIZE},
+  {"job.lastPrintTime", JOB_LAST_PRINT_TIME},
+  {"progress.completion", JOB_COMPLETION},
+  {"progress.filepos", JOB_FILEPOS},
+  {"progress.printTime", JOB_PRINT_TIME},
+  {"progress.printTimeLeft", JOB_PRINT_TIME_LEFT},
+  {"job.filament.tool0.length", JOB_FILAMENT_LENGTH},
+  {"state", JOB_STATE}
+};
+
+const JsonPath OctoPrintClient::PRINTER_PATHS[] = {
+  {"state.flags.printing", PRINTER_PRINTING},
+  {"temperature.tool0.actual", PRINTER_TOOL_TEMP},
+  {"temperature.tool0.target", PRINTER_TOOL_TARGET},
+  {"temperature.bed.actual", PRINTER_BED_TEMP},
+  {"temperature.bed.target", PRINTER_BED_TARGET}
+};
+
+const JsonPath OctoPrintClient::PSU_PATHS[] = {
+  {"isPSUOn", PSU_ON}
+};
+
+OctoPrintClient::OctoPrintClient(const char* ApiKey, const char* server, int port, const char* user, const char* pass, boolean psu) : breaker("OctoPrint"),
+    jobExtractor(JOB_PATHS, sizeof(JOB_PATHS) / sizeof(JsonPath), onValue, this),
+    printerExtractor(PRINTER_PATHS, sizeof(PRINTER_PATHS) / sizeof(JsonPath), onValue, this),
+    psuExtractor(PSU_PATHS, sizeof(PSU_PATHS) / sizeof(JsonPath), onValue, this) {
+  printerData.reset();
+  staged.reset();
   updatePrintClient(ApiKey, server, port, user, pass, psu);
 }
 
-void OctoPrintClient::updatePrintClient(String ApiKey, String server, int port, String user, String pass, boolean psu) {
-  server.toCharArray(myServer, 100);
+void OctoPrintClient::updatePrintClient(const char* ApiKey, const char* server, int port, const char* user, const char* pass, boolean psu) {
+  if (strcmp(server, myServer) != 0 || port != myPort || myApiKey != ApiKey) {
+    connectionPool.close(myServer, myPort); // do not keep a connection to the old server around
+    pushClient.close();
+    pushAttempted = false;
+    breaker.reset();
+    reachability.forget(myServer, myPort);
+    resetPrintData(); // belongs to the old server
+  }
+  snprintf(myServer, sizeof(myServer), "%s", server);
   myApiKey = ApiKey;
   myPort = port;
-  encodedAuth = "";
-  if (user != "") {
-    String userpass = user + ":" + pass;
+  encodedAuth.clear();
+  if (user[0] != '\0') {
     base64 b64;
-    encodedAuth = b64.encode(userpass, true);
+    encodedAuth = b64.encode(String(user) + ":" + pass, true);
   }
   pollPsu = psu;
+  renderHeaders();
+}
+
+// The headers only change with the settings, so they are rendered once instead of per request
+void OctoPrintClient::renderHeaders() {
+  int length = snprintf(headerBlock, sizeof(headerBlock),
+    "Host: %s:%d\r\nX-Api-Key: %s\r\n%s%s%sUser-Agent: ArduinoWiFi/1.1\r\nConnection: keep-alive\r\n",
+    myServer, myPort, myApiKey.c_str(),
+    encodedAuth != "" ? "Authorization: Basic " : "", encodedAuth.c_str(), encodedAuth != "" ? "\r\n" : "");
+  if (length >= (int)sizeof(headerBlock)) {
+    Serial.println("OctoPrint request headers too long, truncated");
+  }
+  Serial.printf("OctoPrint request headers rendered: %u bytes\n", (unsigned)strlen(headerBlock));
 }
 
 boolean OctoPrintClient::validate() {
   boolean rtnValue = false;
-  printerData.error = "";
+  printerError.clear();
   if (String(myServer) == "") {
-    printerData.error += "Server address is required; ";
+    printerError += "Server address is required; ";
   }
   if (myApiKey == "") {
-    printerData.error += "ApiKey is required; ";
+    printerError += "ApiKey is required; ";
   }
-  if (printerData.error == "") {
+  if (printerError == "") {
     rtnValue = true;
   }
   return rtnValue;
 }
 
-WiFiClient OctoPrintClient::getSubmitRequest(String apiGetData) {
-  WiFiClient printClient;
-  printClient.setTimeout(5000);
-
+boolean OctoPrintClient::getSubmitRequest(const char* apiGetData, const ResponseFingerprint &fingerprint, JsonStreamExtractor &extractor) {
   Serial.println("Getting Octoprint Data via GET");
   Serial.println(apiGetData);
-  result = "";
-  if (printClient.connect(myServer, myPort)) {  //starts client connection, checks for connection
-    printClient.println(apiGetData);
-    printClient.println("Host: " + String(myServer) + ":" + String(myPort));
-    printClient.println("X-Api-Key: " + myApiKey);
-    if (encodedAuth != "") {
-      printClient.print("Authorization: ");
-      printClient.println("Basic " + encodedAuth);
-    }
-    printClient.println("User-Agent: ArduinoWiFi/1.1");
-    printClient.println("Connection: close");
-    if (printClient.println() == 0) {
-      Serial.println("Connection to " + String(myServer) + ":" + String(myPort) + " failed.");
-      Serial.println();
-      resetPrintData();
-      printerData.error = "Connection to " + String(myServer) + ":" + String(myPort) + " failed.";
-      return printClient;
-    }
-  } 
-  else {
-    Serial.println("Connection to OctoPrint failed: " + String(myServer) + ":" + String(myPort)); //error message if no client connect
-    Serial.println();
-    resetPrintData();
-    printerData.error = "Connection to OctoPrint failed: " + String(myServer) + ":" + String(myPort);
-    return printClient;
-  }
-
-  // Check HTTP status
-  char status[32] = {0};
-  printClient.readBytesUntil('\r', status, sizeof(status));
-  if (strcmp(status, "HTTP/1.1 200 OK") != 0 && strcmp(status, "HTTP/1.1 409 CONFLICT") != 0) {
-    Serial.print(F("Unexpected response: "));
-    Serial.println(status);
-    printerData.state = "";
-    printerData.error = "Response: " + String(status);
-    return printClient;
-  }
-
-  // Skip HTTP headers
-  char endOfHeaders[] = "\r\n\r\n";
-  if (!printClient.find(endOfHeaders)) {
-    Serial.println(F("Invalid response"));
-    printerData.error = "Invalid response from " + String(myServer) + ":" + String(myPort);
-    printerData.state = "";
-  }
+  return httpClient.begin(myServer, myPort, apiGetData, headerBlock, &fingerprint, NULL, &extractor);
+}
 
-  return printClient;
+boolean OctoPrintClient::queueSubmitRequest(const char* apiGetData, const ResponseFingerprint &fingerprint, JsonStreamExtractor &extractor) {
+  Serial.printf("Pipelining Octoprint GET: %s\n", apiGetData);
+  return httpClient.queue(apiGetData, headerBlock, &fingerprint, NULL, &extractor);
 }
 
-WiFiClient OctoPrintClient::getPostRequest(String apiPostData, String apiPostBody) {
-  WiFiClient printClient;
-  printClient.setTimeout(5000);
+boolean OctoPrintClient::queuePostRequest(const char* apiPostData, const char* apiPostBody, JsonStreamExtractor* extractor) {
+  Serial.printf("Pipelining Octoprint POST: %s | %s\n", apiPostData, apiPostBody);
+  return httpClient.queue(apiPostData, headerBlock, NULL, apiPostBody, extractor);
+}
 
+boolean OctoPrintClient::getPostRequest(const char* apiPostData, const char* apiPostBody, JsonStreamExtractor* extractor) {
   Serial.println("Getting Octoprint Data via POST");
-  Serial.println(apiPostData + " | " + apiPostBody);
-  result = "";
-  if (printClient.connect(myServer, myPort)) {  //starts client connection, checks for connection
-    printClient.println(apiPostData);
-    printClient.println("Host: " + String(myServer) + ":" + String(myPort));
-    printClient.println("Connection: close");
-    printClient.println("X-Api-Key: " + myApiKey);
-    if (encodedAuth != "") {
-      printClient.print("Authorization: ");
-      printClient.println("Basic " + encodedAuth);
-    }
-    printClient.println("User-Agent: ArduinoWiFi/1.1");
-    printClient.println("Content-Type: application/json");
-    printClient.print("Content-Length: ");
-    printClient.println(apiPostBody.length());
-    printClient.println();
-    printClient.println(apiPostBody);
-    if (printClient.println() == 0) {
-      Serial.println("Connection to " + String(myServer) + ":" + String(myPort) + " failed.");
-      Serial.println();
-      resetPrintData();
-      printerData.error = "Connection to " + String(myServer) + ":" + String(myPort) + " failed.";
-      return printClient;
-    }
-  } 
-  else {
-    Serial.println("Connection to OctoPrint failed: " + String(myServer) + ":" + String(myPort)); //error message if no client connect
-    Serial.println();
-    resetPrintData();
-    printerData.error = "Connection to OctoPrint failed: " + String(myServer) + ":" + String(myPort);
-    return printClient;
-  }
+  Serial.printf("%s | %s\n", apiPostData, apiPostBody);
+  return httpClient.begin(myServer, myPort, apiPostData, headerBlock, NULL, apiPostBody, extractor);
+}
 
-  // Check HTTP status
-  char status[32] = {0};
-  printClient.readBytesUntil('\r', status, sizeof(status));
-  if (strcmp(status, "HTTP/1.1 200 OK") != 0 && strcmp(status, "HTTP/1.1 409 CONFLICT") != 0) {
+// Checks the finished request; returns false (with printerError set) if there is nothing to parse
+boolean OctoPrintClient::checkResponse() {
+  if (httpClient.isFailed()) {
+    breaker.recordFailure();
+    markStale(httpClient.getError().c_str());
+    return false;
+  }
+  if (httpClient.getStatusCode() >= 500) {
+    breaker.recordFailure();
+  } else {
+    breaker.recordSuccess();
+  }
+  int status = httpClient.getStatusCode();
+  if (status != 200 && status != 304 && status != 409) {
     Serial.print(F("Unexpected response: "));
-    Serial.println(status);
-    printerData.state = "";
-    printerData.error = "Response: " + String(status);
-    return printClient;
+    Serial.println(httpClient.getStatusLine());
+    printerData.setState(NULL);
+    printerError = scratch.format("Response: %s", httpClient.getStatusLine());
+    clearFingerprints();
+    return false;
   }
+  updatedAt = millis();
+  return true;
+}
 
-  // Skip HTTP headers
-  char endOfHeaders[] = "\r\n\r\n";
-  if (!printClient.find(endOfHeaders)) {
-    Serial.println(F("Invalid response"));
-    printerData.error = "Invalid response from " + String(myServer) + ":" + String(myPort);
-    printerData.state = "";
+// A failed request keeps the last known printerData, flagged by the error and its
+// age, so one dropped poll does not blank the display. It is only thrown away once
+// the breaker has backed off as far as it goes, or the settings change.
+void OctoPrintClient::markStale(const char* error) {
+  if (breaker.isAtMaxBackoff() && updatedAt != 0) {
+    Serial.println("Printer down for too long, dropping its last known state");
+    resetPrintData();
   }
+  clearFingerprints();
+  printerError = error;
+}
 
-  return printClient;
+// Forget the last responses so the next ones are parsed even if identical
+void OctoPrintClient::clearFingerprints() {
+  httpClient.clearFingerprint(jobFingerprint);
+  httpClient.clearFingerprint(printerFingerprint);
+  httpClient.clearFingerprint(psuFingerprint);
 }
 
 void OctoPrintClient::getPrinterJobResults() {
+  if (pollStep != STEP_IDLE) {
+    return; // previous poll still running
+  }
+  if (!breaker.allowRequest()) {
+    return; // host is down, keep serving the last known state until the retry time
+  }
   if (!validate()) {
     return;
   }
-  //**** get the Printer Job status
-  String apiGetData = "GET /api/job HTTP/1.1";
-  WiFiClient printClient = getSubmitRequest(apiGetData);
-  if (printerData.error != "") {
+  if (isPushActive()) {
+    return; // job and printer state arrive over the push socket
+  }
+  if (!reachability.isReachable(myServer, myPort)) {
+    // a host refusing connections costs one short probe instead of a full request
+    breaker.recordFailure();
+    markStale(scratch.format("Connection refused: %s:%d", myServer, myPort));
     return;
   }
-  const size_t bufferSize = JSON_OBJECT_SIZE(1) + JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(3) + 2*JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(6) + 710;
-  DynamicJsonBuffer jsonBuffer(bufferSize);
+  psuRequested = false;
+  //**** get the Printer Job status
+  if (getSubmitRequest("GET /api/job HTTP/1.1", jobFingerprint, jobExtractor)) {
+    pollStep = STEP_JOB;
+    // printer and PSU go out on the same connection right behind it and are answered in order
+    //**** get the Printer Temps and Stat
+    printerQueued = queueSubmitRequest("GET /api/printer?exclude=sd,history HTTP/1.1", printerFingerprint, printerExtractor);
+    //**** get the PSU state (if enabled), applied only if the printer turns out to be operational
+    psuQueued = pollPsu && queuePostRequest("POST /api/plugin/psucontrol HTTP/1.1", "{\"command\":\"getPSUState\"}", &psuExtractor);
+  }
+}
 
-  // Parse JSON object
-  JsonObject& root = jsonBuffer.parseObject(printClient);
-  if (!root.success()) {
-    Serial.println("OctoPrint Data Parsing failed: " + String(myServer) + ":" + String(myPort));
-    printerData.error = "OctoPrint Data Parsing failed: " + String(myServer) + ":" + String(myPort);
-    printerData.state = "";
+void OctoPrintClient::handle() {
+  handlePush();
+  if (pollStep == STEP_IDLE) {
+    return;
+  }
+  httpClient.handle();
+  if (httpClient.isBusy()) {
     return;
   }
-  
-  printerData.averagePrintTime = (const char*)root["job"]["averagePrintTime"];
-  printerData.estimatedPrintTime = (const char*)root["job"]["estimatedPrintTime"];
-  printerData.fileName = (const char*)root["job"]["file"]["name"];
-  printerData.fileSize = (const char*)root["job"]["file"]["size"];
-  printerData.lastPrintTime = (const char*)root["job"]["lastPrintTime"];
-  printerData.progressCompletion = (const char*)root["progress"]["completion"];
-  printerData.progressFilepos = (const char*)root["progress"]["filepos"];
-  printerData.progressPrintTime = (const char*)root["progress"]["printTime"];
-  printerData.progressPrintTimeLeft = (const char*)root["progress"]["printTimeLeft"];
-  printerData.filamentLength = (const char*)root["job"]["filament"]["tool0"]["length"];
-  printerData.state = (const char*)root["state"];
 
-  if (isOperational()) {
-    Serial.println("Status: " + printerData.state);
+  PollStep finished = pollStep;
+  pollStep = STEP_IDLE;
+  boolean ok = (finished == STEP_LOGIN) || (finished == STEP_DISCARD) || checkResponse();
+  switch (finished) {
+    case STEP_JOB:
+      jobParsed = ok && processJobResults();
+      if (!jobParsed && httpClient.hasNext()) {
+        // printer and PSU answers of a failed poll are read off the connection but not applied
+        pollStep = STEP_DISCARD;
+      } else if (httpClient.hasNext()) {
+        pollStep = STEP_PRINTER;
+      } else if (jobParsed && !printerQueued) {
+        // did not fit in the pipeline, ask on its own
+        if (getSubmitRequest("GET /api/printer?exclude=sd,history HTTP/1.1", printerFingerprint, printerExtractor)) {
+          pollStep = STEP_PRINTER;
+        }
+      }
+      break;
+    case STEP_PRINTER:
+      if (ok) {
+        processPrinterResults();
+      }
+      if (httpClient.hasNext()) {
+        pollStep = STEP_PSU;
+      }
+      break;
+    case STEP_PSU:
+      if (!isOperational()) {
+        printerData.isPSUoff = false; // we are not checking PSU state, so assume on
+        httpClient.clearFingerprint(psuFingerprint);
+      } else if (ok) {
+        processPsuResults();
+      } else {
+        printerData.isPSUoff = false; // we do not know PSU state, so assume on.
+      }
+      break;
+    case STEP_DISCARD:
+      if (httpClient.hasNext()) {
+        pollStep = STEP_DISCARD;
+      }
+      break;
+    case STEP_LOGIN:
+      if (httpClient.isFailed()) {
+        breaker.recordFailure();
+      } else {
+        breaker.recordSuccess();
+      }
+      if (httpClient.isDone() && httpClient.getStatusCode() == 200) {
+        startPush();
+      } else {
+        Serial.println("OctoPrint login failed, staying on REST polling");
+      }
+      break;
+    default:
+      break;
+  }
+  if (pollStep == STEP_IDLE) {
+    httpClient.reset(); // free the response body
+    psuQueued = false;
   } else {
-    Serial.println("Printer Not Operational");
+    httpClient.next(); // pipelined response
+  }
+
+  if (pollStep == STEP_IDLE && psuRequested) {
+    psuRequested = false;
+    getPrinterPsuState();
+  }
+}
+
+boolean OctoPrintClient::isBusy() {
+  return pollStep != STEP_IDLE;
+}
+
+CircuitBreaker &OctoPrintClient::getCircuitBreaker() {
+  return breaker;
+}
+
+boolean OctoPrintClient::isPushActive() {
+  return pushClient.isConnected() && pushAuthSent && millis() - lastPushMessage < OCTOPRINT_PUSH_STALE;
+}
+
+// Keeps the push socket open; REST polling covers for it while it is down
+void OctoPrintClient::handlePush() {
+  if (pushClient.handle()) {
+    processPushMessage(pushClient.getMessage(), pushClient.getMessageLength());
+  }
+  if (pushClient.isConnected() && !pushAuthSent) {
+    // authenticate the socket with the session of the passive login, at most one update per second
+    pushClient.send(scratch.format("{\"auth\":\"%s\"}", pushAuth.c_str()));
+    pushClient.send("{\"throttle\":2}");
+    pushAuthSent = true;
+    lastPushMessage = millis();
+    Serial.println("OctoPrint push updates active");
+  }
+
+  if (!pushClient.isClosed() || pollStep != STEP_IDLE || myServer[0] == '\0' || myApiKey == "") {
+    return;
+  }
+  if (pushAttempted && millis() - lastPushAttempt < OCTOPRINT_PUSH_RETRY) {
+    return;
+  }
+  if (!breaker.allowRequest()) {
+    return;
+  }
+  pushAttempted = true;
+  lastPushAttempt = millis();
+  if (!reachability.isReachable(myServer, myPort)) {
+    return;
+  }
+  //**** passive login gives us the session the socket authenticates with
+  if (getPostRequest("POST /api/login HTTP/1.1", "{\"passive\":true}")) {
+    pollStep = STEP_LOGIN;
   }
+}
 
-  //**** get the Printer Temps and Stat
-  apiGetData = "GET /api/printer?exclude=sd,history HTTP/1.1";
-  printClient = getSubmitRequest(apiGetData);
-  if (printerData.error != "") {
+void OctoPrintClient::startPush() {
+  // parsed in place, the body is not used afterwards
+  PooledJsonBuffer jsonBuffer(httpClient.getBody().length());
+  JsonObject& root = jsonBuffer.parseObject(httpClient.getBody().begin());
+  const char* name = root["name"] | "";
+  const char* session = root["session"] | "";
+  if (!root.success() || name[0] == '\0' || session[0] == '\0') {
+    Serial.println("OctoPrint login did not return a session, staying on REST polling");
     return;
   }
-  const size_t bufferSize2 = 3*JSON_OBJECT_SIZE(2) + 2*JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(9) + 300;
-  DynamicJsonBuffer jsonBuffer2(bufferSize2);
+  pushAuth = name;
+  pushAuth += ':';
+  pushAuth += session;
+  pushAuthSent = false;
+
+  const char* headers = "";
+  if (encodedAuth != "") {
+    headers = scratch.format("Authorization: Basic %s\r\n", encodedAuth.c_str());
+  }
+  pushClient.connect(myServer, myPort, "/sockjs/websocket", headers);
+}
 
-  // Parse JSON object
-  JsonObject& root2 = jsonBuffer2.parseObject(printClient);
-  if (!root2.success()) {
-    printerData.isPrinting = false;
-    printerData.toolTemp = "";
-    printerData.toolTargetTemp = "";
-    printerData.bedTemp = "";
-    printerData.bedTargetTemp = (const char*)root2["temperature"]["bed"]["target"];
+// Applies whatever parts of a "current" or "history" message are present
+void OctoPrintClient::processPushMessage(char* message, size_t length) {
+  PooledJsonBuffer jsonBuffer(length);
+
+  // parsed in place, the message is not used afterwards
+  JsonObject& root = jsonBuffer.parseObject(message);
+  if (!root.success()) {
+    Serial.println("OctoPrint push message parsing failed");
     return;
   }
+  JsonObject& data = root.containsKey("current") ? root["current"] : root["history"];
+  if (!data.success()) {
+    return; // connected, event and plugin messages
+  }
+  lastPushMessage = millis();
+  printerError.clear();
+  clearFingerprints(); // REST results are older than this
+
+  JsonObject& state = data["state"];
+  if (state.success()) {
+    printerData.setState(state["text"]);
+    printerData.isPrinting = state["flags"]["printing"].as<bool>();
+  }
 
-  String printing = (const char*)root2["state"]["flags"]["printing"];
-  if (printing == "true") {
-    printerData.isPrinting = true;
+  JsonObject& job = data["job"];
+  if (job.success()) {
+    printerData.averagePrintTime = PrinterState::parseWhole(job["averagePrintTime"]);
+    printerData.estimatedPrintTime = PrinterState::parseWhole(job["estimatedPrintTime"]);
+    printerData.setFileName(job["file"]["name"]);
+    printerData.fileSize = PrinterState::parseWhole(job["file"]["size"]);
+    printerData.lastPrintTime = PrinterState::parseWhole(job["lastPrintTime"]);
+    printerData.filamentLength = PrinterState::parseWhole(job["filament"]["tool0"]["length"]);
+  }
+
+  JsonObject& progress = data["progress"];
+  if (progress.success()) {
+    printerData.progressCompletion = PrinterState::parseTenths(progress["completion"], false);
+    printerData.progressFilepos = PrinterState::parseWhole(progress["filepos"]);
+    printerData.progressPrintTime = PrinterState::parseWhole(progress["printTime"]);
+    printerData.progressPrintTimeLeft = PrinterState::parseWhole(progress["printTimeLeft"]);
+  }
+
+  // only the newest sample matters, and it is missing when no new reading came in
+  JsonArray& temps = data["temps"];
+  if (temps.success() && temps.size() > 0) {
+    JsonObject& latest = temps[temps.size() - 1];
+    printerData.toolTemp = PrinterState::parseTenths(latest["tool0"]["actual"]);
+    printerData.toolTargetTemp = PrinterState::parseTenths(latest["tool0"]["target"]);
+    printerData.bedTemp = PrinterState::parseTenths(latest["bed"]["actual"]);
+    printerData.bedTargetTemp = PrinterState::parseTenths(latest["bed"]["target"]);
+  }
+}
+
+// Finishes the JSON of one endpoint; false if it could not be read. The values
+// only reach printerData if the whole body was read and it differs from last time,
+// so a response cut off half way leaves the previous state intact.
+boolean OctoPrintClient::extract(JsonStreamExtractor &extractor, ResponseFingerprint &fingerprint, const JsonPath* paths, uint8_t pathCount) {
+  if (httpClient.getStatusCode() != 304) {
+    if (!httpClient.isStreamed()) {
+      // e.g. a 409 with an error document, read it the same way
+      extractor.begin();
+      extractor.feed(httpClient.getBody().c_str(), httpClient.getBody().length());
+    }
+    if (!extractor.finish()) {
+      httpClient.clearFingerprint(fingerprint);
+      return false;
+    }
+  }
+  if (httpClient.isUnchanged(fingerprint)) {
+    return true; // 304 or the same body as last time
+  }
+  for (uint8_t inx = 0; inx < pathCount; inx++) {
+    applyField(paths[inx].field);
+  }
+  return true;
+}
+
+boolean OctoPrintClient::processJobResults() {
+  if (!extract(jobExtractor, jobFingerprint, JOB_PATHS, sizeof(JOB_PATHS) / sizeof(JsonPath))) {
+    printerError = scratch.format("OctoPrint Data Parsing failed: %s:%d", myServer, myPort);
+    Serial.println(printerError.c_str());
+    printerData.setState(NULL);
+    return false;
+  }
+
+  if (isOperational()) {
+    Serial.printf("Status: %s\n", printerData.getStateText());
   } else {
+    Serial.println("Printer Not Operational");
+  }
+  return true;
+}
+
+void OctoPrintClient::processPrinterResults() {
+  if (!extract(printerExtractor, printerFingerprint, PRINTER_PATHS, sizeof(PRINTER_PATHS) / sizeof(JsonPath))) {
     printerData.isPrinting = false;
+    printerData.toolTemp = PRINTER_TENTHS_UNKNOWN;
+    printerData.toolTargetTemp = PRINTER_TENTHS_UNKNOWN;
+    printerData.bedTemp = PRINTER_TENTHS_UNKNOWN;
+    printerData.bedTargetTemp = PRINTER_TENTHS_UNKNOWN;
+    return;
   }
-  printerData.toolTemp = (const char*)root2["temperature"]["tool0"]["actual"];
-  printerData.toolTargetTemp = (const char*)root2["temperature"]["tool0"]["target"];
-  printerData.bedTemp = (const char*)root2["temperature"]["bed"]["actual"];
-  printerData.bedTargetTemp = (const char*)root2["temperature"]["bed"]["target"];
 
   if (isPrinting()) {
-    Serial.println("Status: " + printerData.state + " " + printerData.fileName + "(" + printerData.progressCompletion + "%)");
+    Serial.printf("Status: %s %s(%d%%)\n", printerData.getStateText(), printerData.fileName, printerData.getCompletionPercent());
   }
 }
 
 void OctoPrintClient::getPrinterPsuState() {
+  if (pollStep != STEP_IDLE) {
+    if (!psuQueued) {
+      psuRequested = true; // checked once the running poll knows whether the printer is operational
+    }
+    return;
+  }
   //**** get the PSU state (if enabled and printer operational)
   if (pollPsu && isOperational()) {
-    if (!validate()) {
-      printerData.isPSUoff = false; // we do not know PSU state, so assume on.
+    if (!breaker.allowRequest()) {
       return;
     }
-    String apiPostData = "POST /api/plugin/psucontrol HTTP/1.1";
-    String apiPostBody = "{\"command\":\"getPSUState\"}";
-    WiFiClient printClient = getPostRequest(apiPostData,apiPostBody);
-    if (printerData.error != "") {
+    if (!validate()) {
       printerData.isPSUoff = false; // we do not know PSU state, so assume on.
+      httpClient.clearFingerprint(psuFingerprint);
       return;
     }
-    const size_t bufferSize3 = JSON_OBJECT_SIZE(2) + 300;
-    DynamicJsonBuffer jsonBuffer3(bufferSize3);
-  
-    // Parse JSON object
-    JsonObject& root3 = jsonBuffer3.parseObject(printClient);
-    if (!root3.success()) {
-      printerData.isPSUoff = false; // we do not know PSU state, so assume on
-      return;
-    }
-  
-    String psu = (const char*)root3["isPSUOn"];
-    if (psu == "true") {
-      printerData.isPSUoff = false; // PSU checked and is on
+    if (getPostRequest("POST /api/plugin/psucontrol HTTP/1.1", "{\"command\":\"getPSUState\"}", &psuExtractor)) {
+      pollStep = STEP_PSU;
     } else {
-      printerData.isPSUoff = true; // PSU checked and is off, set flag
+      printerData.isPSUoff = false; // we do not know PSU state, so assume on.
+      httpClient.clearFingerprint(psuFingerprint);
     }
-    printClient.stop(); //stop client
   } else {
     printerData.isPSUoff = false; // we are not checking PSU state, so assume on
+    httpClient.clearFingerprint(psuFingerprint);
+  }
+}
+
+void OctoPrintClient::processPsuResults() {
+  if (!extract(psuExtractor, psuFingerprint, PSU_PATHS, sizeof(PSU_PATHS) / sizeof(JsonPath))) {
+    printerData.isPSUoff = false; // we do not know PSU state, so assume on
+  }
+}
+
+void OctoPrintClient::onValue(void* context, uint8_t field, const char* value) {
+  ((OctoPrintClient*)context)->setField(field, value);
+}
+
+// Stores one value picked out of a job, printer or PSU response
+void OctoPrintClient::setField(uint8_t field, const char* value) {
+  switch (field) {
+    case JOB_AVERAGE_PRINT_TIME: staged.averagePrintTime = PrinterState::parseWhole(value); break;
+    case JOB_ESTIMATED_PRINT_TIME: staged.estimatedPrintTime = PrinterState::parseWhole(value); break;
+    case JOB_FILE_NAME: staged.setFileName(value); break;
+    case JOB_FILE_SIZE: staged.fileSize = PrinterState::parseWhole(value); break;
+    case JOB_LAST_PRINT_TIME: staged.lastPrintTime = PrinterState::parseWhole(value); break;
+    case JOB_COMPLETION: staged.progressCompletion = PrinterState::parseTenths(value, false); break;
+    case JOB_FILEPOS: staged.progressFilepos = PrinterState::parseWhole(value); break;
+    case JOB_PRINT_TIME: staged.progressPrintTime = PrinterState::parseWhole(value); break;
+    case JOB_PRINT_TIME_LEFT: staged.progressPrintTimeLeft = PrinterState::parseWhole(value); break;
+    case JOB_FILAMENT_LENGTH: staged.filamentLength = PrinterState::parseWhole(value); break;
+    case JOB_STATE: staged.setState(value); break;
+    case PRINTER_PRINTING: staged.isPrinting = strcmp(value, "true") == 0; break;
+    case PRINTER_TOOL_TEMP: staged.toolTemp = PrinterState::parseTenths(value); break;
+    case PRINTER_TOOL_TARGET: staged.toolTargetTemp = PrinterState::parseTenths(value); break;
+    case PRINTER_BED_TEMP: staged.bedTemp = PrinterState::parseTenths(value); break;
+    case PRINTER_BED_TARGET: staged.bedTargetTemp = PrinterState::parseTenths(value); break;
+    case PSU_ON: staged.isPSUoff = strcmp(value, "true") != 0; break;
+    default: break;
+  }
+}
+
+// Copies one value of a completely read response from staged to printerData
+void OctoPrintClient::applyField(uint8_t field) {
+  switch (field) {
+    case JOB_AVERAGE_PRINT_TIME: printerData.averagePrintTime = staged.averagePrintTime; break;
+    case JOB_ESTIMATED_PRINT_TIME: printerData.estimatedPrintTime = staged.estimatedPrintTime; break;
+    case JOB_FILE_NAME: printerData.setFileName(staged.fileName); break;
+    case JOB_FILE_SIZE: printerData.fileSize = staged.fileSize; break;
+    case JOB_LAST_PRINT_TIME: printerData.lastPrintTime = staged.lastPrintTime; break;
+    case JOB_COMPLETION: printerData.progressCompletion = staged.progressCompletion; break;
+    case JOB_FILEPOS: printerData.progressFilepos = staged.progressFilepos; break;
+    case JOB_PRINT_TIME: printerData.progressPrintTime = staged.progressPrintTime; break;
+    case JOB_PRINT_TIME_LEFT: printerData.progressPrintTimeLeft = staged.progressPrintTimeLeft; break;
+    case JOB_FILAMENT_LENGTH: printerData.filamentLength = staged.filamentLength; break;
+    case JOB_STATE: printerData.setState(staged.stateText); break;
+    case PRINTER_PRINTING: printerData.isPrinting = staged.isPrinting; break;
+    case PRINTER_TOOL_TEMP: printerData.toolTemp = staged.toolTemp; break;
+    case PRINTER_TOOL_TARGET: printerData.toolTargetTemp = staged.toolTargetTemp; break;
+    case PRINTER_BED_TEMP: printerData.bedTemp = staged.bedTemp; break;
+    case PRINTER_BED_TARGET: printerData.bedTargetTemp = staged.bedTargetTemp; break;
+    case PSU_ON: printerData.isPSUoff = staged.isPSUoff; break;
+    default: break;
   }
 }
 
 // Reset all PrinterData
 void OctoPrintClient::resetPrintData() {
-  printerData.averagePrintTime = "";
-  printerData.estimatedPrintTime = "";
-  printerData.fileName = "";
-  printerData.fileSize = "";
-  printerData.lastPrintTime = "";
-  printerData.progressCompletion = "";
-  printerData.progressFilepos = "";
-  printerData.progressPrintTime = "";
-  printerData.progressPrintTimeLeft = "";
-  printerData.state = "";
-  printerData.toolTemp = "";
-  printerData.toolTargetTemp = "";
-  printerData.filamentLength = "";
-  printerData.bedTemp = "";
-  printerData.bedTargetTemp = "";
-  printerData.isPrinting = false;
-  printerData.isPSUoff = false;
-  printerData.error = "";
+  printerData.reset();
+  printerError.clear();
+  updatedAt = 0;
 }
 
 String OctoPrintClient::getAveragePrintTime(){
-  return printerData.averagePrintTime;
+  return PrinterState::formatWhole(printerData.averagePrintTime);
 }
 
 String OctoPrintClient::getEstimatedPrintTime() {
-  return printerData.estimatedPrintTime;
+  return PrinterState::formatWhole(printerData.estimatedPrintTime);
 }
 
 String OctoPrintClient::getFileName() {
@@ -320,35 +569,34 @@ String OctoPrintClient::getFileName() {
 }
 
 String OctoPrintClient::getFileSize() {
-  return printerData.fileSize;
+  return PrinterState::formatWhole(printerData.fileSize);
 }
 
 String OctoPrintClient::getLastPrintTime(){
-  return printerData.lastPrintTime;
+  return PrinterState::formatWhole(printerData.lastPrintTime);
 }
 
 String OctoPrintClient::getProgressCompletion() {
-  return String(printerData.progressCompletion.toInt());
+  return String(printerData.getCompletionPercent());
 }
 
 String OctoPrintClient::getProgressFilepos() {
-  return printerData.progressFilepos;  
+  return PrinterState::formatWhole(printerData.progressFilepos);
 }
 
 String OctoPrintClient::getProgressPrintTime() {
-  return printerData.progressPrintTime;
+  return PrinterState::formatWhole(printerData.progressPrintTime);
 }
 
 String OctoPrintClient::getProgressPrintTimeLeft() {
-  String rtnValue = printerData.progressPrintTimeLeft;
-  if (getProgressCompletion() == "100") {
-    rtnValue = "0"; // Print is done so this should be 0 this is a fix for OctoPrint
+  if (printerData.progressPrintTimeLeft == PRINTER_VALUE_UNKNOWN) {
+    return "";
   }
-  return rtnValue;
+  return String(printerData.getPrintTimeLeft());
 }
 
 String OctoPrintClient::getState() {
-  return printerData.state;
+  return printerData.getStateText();
 }
 
 boolean OctoPrintClient::isPrinting() {
@@ -361,34 +609,46 @@ boolean OctoPrintClient::isPSUoff() {
 
 boolean OctoPrintClient::isOperational() {
   boolean operational = false;
-  if (printerData.state == "Operational" || isPrinting()) {
+  if (printerData.state == PRINTER_OPERATIONAL || isPrinting()) {
     operational = true;
   }
   return operational;
 }
 
 String OctoPrintClient::getTempBedActual() {
-  return printerData.bedTemp;
+  return PrinterState::formatTenths(printerData.bedTemp);
 }
 
 String OctoPrintClient::getTempBedTarget() {
-  return printerData.bedTargetTemp;
+  return PrinterState::formatTenths(printerData.bedTargetTemp);
 }
 
 String OctoPrintClient::getTempToolActual() {
-  return printerData.toolTemp;
+  return PrinterState::formatTenths(printerData.toolTemp);
 }
 
 String OctoPrintClient::getTempToolTarget() {
-  return printerData.toolTargetTemp;
+  return PrinterState::formatTenths(printerData.toolTargetTemp);
 }
 
 String OctoPrintClient::getFilamentLength() {
-  return printerData.filamentLength;
+  return PrinterState::formatWhole(printerData.filamentLength);
+}
+
+const PrinterState &OctoPrintClient::getPrinterState() {
+  return printerData;
 }
 
 String OctoPrintClient::getError() {
-  return printerData.error;
+  return printerError.c_str();
+}
+
+// seconds since printerData was last confirmed by the server, -1 if it holds nothing
+long OctoPrintClient::getDataAge() {
+  if (updatedAt == 0) {
+    return -1;
+  }
+  return (millis() - updatedAt) / 1000;
 }
 
 String OctoPrintClient::getValueRounded(String value) {
@@ -406,9 +666,9 @@ int OctoPrintClient::getPrinterPort() {
 }
 
 String OctoPrintClient::getPrinterName() {
-  return printerData.printerName;
+  return printerName.c_str();
 }
 
 void OctoPrintClient::setPrinterName(String printer) {
-  printerData.printerName = printer;
+  printerName = printer;
 }
@@ -27,55 +27,111 @@ SOFTWARE.
 #pragma once
 #include <ESP8266WiFi.h>
 #include "libs/ArduinoJson/ArduinoJson.h"
+#include "JsonBufferPool.h"
 #include <base64.h>
+#include "AsyncHttpClient.h"
+#include "WebSocketClient.h"
+#include "CircuitBreaker.h"
+#include "ReachabilityProbe.h"
+#include "PrinterState.h"
+#include "ScratchArena.h"
+#include "FixedString.h"
+
+#define OCTOPRINT_PUSH_RETRY 60000   // ms between attempts to open the push socket
+#define OCTOPRINT_PUSH_STALE 10000   // ms without a usable push message before REST polling takes over
 
 class OctoPrintClient {
 
 private:
-  char myServer[100];
+  char myServer[100] = "";
   int myPort = 80;
-  String myApiKey = "";
-  String encodedAuth = "";
+  FixedString<60> myApiKey;
+  FixedString<132> encodedAuth; // base64 of user:pass, with its line breaks
+  char headerBlock[HTTP_HEADER_BLOCK_SIZE] = "";
   boolean pollPsu;
   const String printerType = "OctoPrint";
 
   void resetPrintData();
   boolean validate();
-  WiFiClient getSubmitRequest(String apiGetData);
-  WiFiClient getPostRequest(String apiPostData, String apiPostBody);
- 
-  String result;
+  boolean getSubmitRequest(const char* apiGetData, const ResponseFingerprint &fingerprint, JsonStreamExtractor &extractor);
+  boolean getPostRequest(const char* apiPostData, const char* apiPostBody, JsonStreamExtractor* extractor = NULL);
+  boolean queueSubmitRequest(const char* apiGetData, const ResponseFingerprint &fingerprint, JsonStreamExtractor &extractor);
+  boolean queuePostRequest(const char* apiPostData, const char* apiPostBody, JsonStreamExtractor* extractor = NULL);
+  void renderHeaders();
+  boolean checkResponse();
+  void clearFingerprints();
+  void markStale(const char* error);
+  boolean extract(JsonStreamExtractor &extractor, ResponseFingerprint &fingerprint, const JsonPath* paths, uint8_t pathCount);
+  boolean processJobResults();
+  void processPrinterResults();
+  void processPsuResults();
+  void setField(uint8_t field, const char* value);
+  void applyField(uint8_t field);
+  static void onValue(void* context, uint8_t field, const char* value);
+  void startPush();
+  void handlePush();
+  void processPushMessage(char* message, size_t length);
+
+  enum PollStep { STEP_IDLE, STEP_JOB, STEP_PRINTER, STEP_PSU, STEP_LOGIN, STEP_DISCARD };
+  enum ResponseField {
+    JOB_AVERAGE_PRINT_TIME,
+    JOB_ESTIMATED_PRINT_TIME,
+    JOB_FILE_NAME,
+    JOB_FILE_SIZE,
+    JOB_LAST_PRINT_TIME,
+    JOB_COMPLETION,
+    JOB_FILEPOS,
+    JOB_PRINT_TIME,
+    JOB_PRINT_TIME_LEFT,
+    JOB_FILAMENT_LENGTH,
+    JOB_STATE,
+    PRINTER_PRINTING,
+    PRINTER_TOOL_TEMP,
+    PRINTER_TOOL_TARGET,
+    PRINTER_BED_TEMP,
+    PRINTER_BED_TARGET,
+    PSU_ON
+  };
+  static const JsonPath JOB_PATHS[];
+  static const JsonPath PRINTER_PATHS[];
+  static const JsonPath PSU_PATHS[];
+  AsyncHttpClient httpClient;
+  CircuitBreaker breaker;
+  PollStep pollStep = STEP_IDLE;
+  boolean psuRequested = false;
+  boolean printerQueued = false;
+  boolean psuQueued = false;
+  boolean jobParsed = false;
+  ResponseFingerprint jobFingerprint;
+  ResponseFingerprint printerFingerprint;
+  ResponseFingerprint psuFingerprint;
+  JsonStreamExtractor jobExtractor;
+  JsonStreamExtractor printerExtractor;
+  JsonStreamExtractor psuExtractor;
 
-  typedef struct {
-    String averagePrintTime;
-    String estimatedPrintTime;
-    String fileName;
-    String fileSize;
-    String lastPrintTime;
-    String progressCompletion;
-    String progressFilepos;
-    String progressPrintTime;
-    String progressPrintTimeLeft;
-    String state;
-    String toolTemp;
-    String toolTargetTemp;
-    String filamentLength;
-    String bedTemp;
-    String bedTargetTemp;
-    boolean isPrinting;
-    boolean isPSUoff;
-    String error;
-    String printerName;
-  } PrinterStruct;
+  WebSocketClient pushClient;
+  FixedString<96> pushAuth;
+  boolean pushAuthSent = false;
+  boolean pushAttempted = false;
+  unsigned long lastPushAttempt = 0;
+  unsigned long lastPushMessage = 0;
 
-  PrinterStruct printerData;
+  PrinterState printerData;
+  unsigned long updatedAt = 0; // millis() of the last good response, 0 after a reset
+  PrinterState staged; // what the extractors read, copied to printerData once a response checks out
+  FixedString<96> printerError;
+  FixedString<40> printerName;
 
   
 public:
-  OctoPrintClient(String ApiKey, String server, int port, String user, String pass, boolean psu);
+  OctoPrintClient(const char* ApiKey, const char* server, int port, const char* user, const char* pass, boolean psu);
   void getPrinterJobResults();
   void getPrinterPsuState();
-  void updatePrintClient(String ApiKey, String server, int port, String user, String pass, boolean psu);
+  void handle();
+  boolean isBusy();
+  boolean isPushActive();
+  CircuitBreaker &getCircuitBreaker();
+  void updatePrintClient(const char* ApiKey, const char* server, int port, const char* user, const char* pass, boolean psu);
 
   String getAveragePrintTime();
   String getEstimatedPrintTime();
@@ -96,7 +152,9 @@ public:
   String getTempToolTarget();
   String getFilamentLength();
   String getValueRounded(String value);
+  const PrinterState &getPrinterState();
   String getError();
+  long getDataAge();
   String getPrinterType();
   int getPrinterPort();
   String getPrinterName();
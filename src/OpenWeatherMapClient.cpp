@@ -23,138 +23,186 @@ SOFTWARE.
 
 #include "OpenWeatherMapClient.h"
 
-OpenWeatherMapClient::OpenWeatherMapClient(String ApiKey, int CityIDs[], int cityCount, boolean isMetric, String language) {
+const char* const OpenWeatherMapClient::CONDITION_NAMES[CONDITION_COUNT] = {
+  "", "Thunderstorm", "Drizzle", "Rain", "Snow", "Mist", "Smoke", "Haze", "Dust", "Fog", "Sand",
+  "Ash", "Squall", "Tornado", "Clear", "Clouds"
+};
+
+// without the trailing 'd' / 'n' for day and night
+const char* const OpenWeatherMapClient::ICON_CODES[ICON_COUNT] = {
+  "", "01", "02", "03", "04", "09", "10", "11", "13", "50"
+};
+
+OpenWeatherMapClient::OpenWeatherMapClient(const char* ApiKey, int CityIDs[], int cityCount, boolean isMetric, const char* language) {
+  memset(weathers, 0, sizeof(weathers));
   updateCityIdList(CityIDs, cityCount);
   updateLanguage(language);
   myApiKey = ApiKey;
   setMetric(isMetric);
+  renderHeaders();
 }
 
-void OpenWeatherMapClient::updateWeatherApiKey(String ApiKey) {
+void OpenWeatherMapClient::updateWeatherApiKey(const char* ApiKey) {
   myApiKey = ApiKey;
+  renderHeaders();
 }
 
-void OpenWeatherMapClient::updateLanguage(String language) {
+// The key travels in the query string, so the headers are the same for every request
+void OpenWeatherMapClient::renderHeaders() {
+  snprintf(headerBlock, sizeof(headerBlock), "Host: %s\r\nUser-Agent: ArduinoWiFi/1.1\r\nConnection: keep-alive\r\n", servername);
+}
+
+void OpenWeatherMapClient::updateLanguage(const char* language) {
   lang = language;
-  if (lang == "") {
+  if (lang.isEmpty()) {
     lang = "en";
   }
 }
 
 void OpenWeatherMapClient::updateWeather() {
-  WiFiClient weatherClient;
-  String apiGetData = "GET /data/2.5/group?id=" + myCityIDs + "&units=" + units + "&cnt=1&APPID=" + myApiKey + "&lang=" + lang + " HTTP/1.1";
+  if (httpClient.isBusy()) {
+    return;
+  }
+  const char* apiGetData = scratch.format("GET /data/2.5/group?id=%s&units=%s&cnt=1&APPID=%s&lang=%s HTTP/1.1",
+    myCityIDs.c_str(), units.c_str(), myApiKey.c_str(), lang.c_str());
 
   Serial.println("Getting Weather Data");
   Serial.println(apiGetData);
-  result = "";
-  if (weatherClient.connect(servername, 80)) {  //starts client connection, checks for connection
-    weatherClient.println(apiGetData);
-    weatherClient.println("Host: " + String(servername));
-    weatherClient.println("User-Agent: ArduinoWiFi/1.1");
-    weatherClient.println("Connection: close");
-    weatherClient.println();
-  } 
-  else {
+  httpClient.begin(servername, 80, apiGetData, headerBlock);
+}
+
+boolean OpenWeatherMapClient::isBusy() {
+  return httpClient.isBusy();
+}
+
+void OpenWeatherMapClient::handle() {
+  if (httpClient.isBusy()) {
+    httpClient.handle();
+  }
+  if (httpClient.isDone() || httpClient.isFailed()) {
+    processWeather();
+    httpClient.reset(); // free the response body
+  }
+}
+
+void OpenWeatherMapClient::processWeather() {
+  if (httpClient.isFailed()) {
     Serial.println("connection for weather data failed"); //error message if no client connect
     Serial.println();
     return;
   }
-
-  while(weatherClient.connected() && !weatherClient.available()) delay(1); //waits for data
- 
-  Serial.println("Waiting for data");
-
-  // Check HTTP status
-  char status[32] = {0};
-  weatherClient.readBytesUntil('\r', status, sizeof(status));
-  Serial.println("Response Header: " + String(status));
-  if (strcmp(status, "HTTP/1.1 200 OK") != 0) {
+  Serial.printf("Response Header: %s\n", httpClient.getStatusLine());
+  if (httpClient.getStatusCode() != 200) {
     Serial.print(F("Unexpected response: "));
-    Serial.println(status);
-    return;
-  }
-
-    // Skip HTTP headers
-  char endOfHeaders[] = "\r\n\r\n";
-  if (!weatherClient.find(endOfHeaders)) {
-    Serial.println(F("Invalid response"));
+    Serial.println(httpClient.getStatusLine());
     return;
   }
 
-  const size_t bufferSize = 710;
-  DynamicJsonBuffer jsonBuffer(bufferSize);
+  PooledJsonBuffer jsonBuffer(httpClient.getBody().length());
 
-  weathers[0].cached = false;
-  weathers[0].error = "";
-  // Parse JSON object
-  JsonObject& root = jsonBuffer.parseObject(weatherClient);
+  cached = false;
+  error.clear();
+  // Parse JSON object, in place: the body is freed right after
+  JsonObject& root = jsonBuffer.parseObject(httpClient.getBody().begin());
   if (!root.success()) {
     Serial.println(F("Weather Data Parsing failed!"));
-    weathers[0].error = "Weather Data Parsing failed!";
+    error = "Weather Data Parsing failed!";
     return;
   }
 
-  weatherClient.stop(); //stop client
-
   if (root.measureLength() <= 150) {
-    Serial.println("Error Does not look like we got the data.  Size: " + String(root.measureLength()));
-    weathers[0].cached = true;
-    weathers[0].error = (const char*)root["message"];
-    Serial.println("Error: " + weathers[0].error);
+    Serial.printf("Error Does not look like we got the data.  Size: %u\n", (unsigned int)root.measureLength());
+    cached = true;
+    error = (const char*)root["message"];
+    Serial.printf("Error: %s\n", error.c_str());
     return;
   }
   int count = root["cnt"];
+  count = min(count, WEATHER_CITY_COUNT);
 
+  // converted once here, the display and web page only format the numbers
   for (int inx = 0; inx < count; inx++) {
-    weathers[inx].lat = (const char*)root["list"][inx]["coord"]["lat"];
-    weathers[inx].lon = (const char*)root["list"][inx]["coord"]["lon"];
-    weathers[inx].dt = (const char*)root["list"][inx]["dt"];
-    weathers[inx].city = (const char*)root["list"][inx]["name"];
-    weathers[inx].country = (const char*)root["list"][inx]["sys"]["country"];
-    weathers[inx].temp = (const char*)root["list"][inx]["main"]["temp"];
-    weathers[inx].humidity = (const char*)root["list"][inx]["main"]["humidity"];
-    weathers[inx].condition = (const char*)root["list"][inx]["weather"][0]["main"];
-    weathers[inx].wind = (const char*)root["list"][inx]["wind"]["speed"];
-    weathers[inx].weatherId = (const char*)root["list"][inx]["weather"][0]["id"];
-    weathers[inx].description = (const char*)root["list"][inx]["weather"][0]["description"];
-    weathers[inx].icon = (const char*)root["list"][inx]["weather"][0]["icon"];
-    weathers[inx].sunrise = (const char*)root["list"][inx]["sys"]["sunrise"];
-	  weathers[inx].sunset = (const char*)root["list"][inx]["sys"]["sunset"];
-
-    Serial.println("lat: " + weathers[inx].lat);
-    Serial.println("lon: " + weathers[inx].lon);
-    Serial.println("dt: " + weathers[inx].dt);
-    Serial.println("city: " + weathers[inx].city);
-    Serial.println("country: " + weathers[inx].country);
-    Serial.println("temp: " + weathers[inx].temp);
-    Serial.println("humidity: " + weathers[inx].humidity);
-    Serial.println("condition: " + weathers[inx].condition);
-    Serial.println("wind: " + weathers[inx].wind);
-    Serial.println("weatherId: " + weathers[inx].weatherId);
-    Serial.println("description: " + weathers[inx].description);
-    Serial.println("icon: " + weathers[inx].icon);
-	  Serial.println("sunrise: " + weathers[inx].sunrise);
-	  Serial.println("sunset: " + weathers[inx].sunset);
-    Serial.println();
+    JsonObject& city = root["list"][inx];
+    JsonObject& current = city["weather"][0];
+    weather &record = weathers[inx];
+    record.lat = lround(city["coord"]["lat"].as<float>() * 10000);
+    record.lon = lround(city["coord"]["lon"].as<float>() * 10000);
+    record.dt = city["dt"].as<unsigned long>();
+    record.sunrise = city["sys"]["sunrise"].as<unsigned long>();
+    record.sunset = city["sys"]["sunset"].as<unsigned long>();
+    record.temp = lround(city["main"]["temp"].as<float>() * 10);
+    record.wind = lround(city["wind"]["speed"].as<float>() * 10);
+    record.humidity = lround(city["main"]["humidity"].as<float>());
+    record.weatherId = current["id"].as<unsigned int>();
+    const char* condition = current["main"] | "";
+    record.condition = lookup(CONDITION_NAMES, CONDITION_COUNT, condition, strlen(condition));
+    const char* icon = current["icon"] | "";
+    record.icon = lookup(ICON_CODES, ICON_COUNT, icon, 2);
+    record.night = strlen(icon) > 2 && icon[2] == 'n';
+    copyText(record.city, sizeof(record.city), city["name"]);
+    copyText(record.country, sizeof(record.country), city["sys"]["country"]);
+    copyText(record.description, sizeof(record.description), current["description"]);
+
+    Serial.printf("city: %s, %s (%.4f, %.4f) dt: %u\n", record.city, record.country, record.lat / 10000.0, record.lon / 10000.0, record.dt);
+    Serial.printf("temp: %.1f humidity: %u wind: %.1f\n", record.temp / 10.0, record.humidity, record.wind / 10.0);
+    Serial.printf("weatherId: %u condition: %s description: %s icon: %s night: %d\n", record.weatherId, CONDITION_NAMES[record.condition],
+                  record.description, ICON_CODES[record.icon], record.night);
+    Serial.printf("sunrise: %u sunset: %u\n\n", record.sunrise, record.sunset);
     
   }
 }
 
-String OpenWeatherMapClient::roundValue(String value) {
-  float f = value.toFloat();
-  int rounded = (int)(f+0.5f);
-  return String(rounded);
+String OpenWeatherMapClient::roundValue(int tenths) {
+  return String((tenths + (tenths < 0 ? -5 : 5)) / 10);
+}
+
+// value / 10^decimals with all decimals shown, e.g. 557522 -> "55.7522"
+String OpenWeatherMapClient::formatFixed(long value, int decimals) {
+  long scale = 1;
+  for (int inx = 0; inx < decimals; inx++) {
+    scale *= 10;
+  }
+  String fraction = String(labs(value) % scale);
+  while ((int)fraction.length() < decimals) {
+    fraction = "0" + fraction;
+  }
+  return String(value < 0 && value > -scale ? "-" : "") + String(value / scale) + "." + fraction;
+}
+
+// Copies as much of text as fits without splitting a UTF-8 character
+void OpenWeatherMapClient::copyText(char* dest, size_t size, const char* text) {
+  if (text == NULL) {
+    text = "";
+  }
+  size_t length = strlen(text);
+  if (length >= size) {
+    length = size - 1;
+    while (length > 0 && (text[length] & 0xC0) == 0x80) {
+      length--;
+    }
+  }
+  memcpy(dest, text, length);
+  dest[length] = '\0';
+}
+
+// Index of text in table, 0 (unknown) if it is not there
+uint8_t OpenWeatherMapClient::lookup(const char* const table[], uint8_t count, const char* text, size_t length) {
+  for (uint8_t inx = 1; inx < count; inx++) {
+    if (strlen(table[inx]) == length && strncmp(table[inx], text, length) == 0) {
+      return inx;
+    }
+  }
+  return 0;
 }
 
 void OpenWeatherMapClient::updateCityIdList(int CityIDs[], int cityCount) {
-  myCityIDs = "";
+  myCityIDs.clear();
   for (int inx = 0; inx < cityCount; inx++) {
     if (CityIDs[inx] > 0) {
-      if (myCityIDs != "") {
-        myCityIDs = myCityIDs + ",";
+      if (!myCityIDs.isEmpty()) {
+        myCityIDs += ',';
       }
-      myCityIDs = myCityIDs + String(CityIDs[inx]); 
+      myCityIDs += CityIDs[inx];
     }
   }
 }
@@ -167,20 +215,16 @@ void OpenWeatherMapClient::setMetric(boolean isMetric) {
   }
 }
 
-String OpenWeatherMapClient::getWeatherResults() {
-  return result;
-}
-
 String OpenWeatherMapClient::getLat(int index) {
-  return weathers[index].lat;
+  return formatFixed(weathers[index].lat, 4);
 }
 
 String OpenWeatherMapClient::getLon(int index) {
-  return weathers[index].lon;
+  return formatFixed(weathers[index].lon, 4);
 }
 
 String OpenWeatherMapClient::getDt(int index) {
-  return weathers[index].dt;
+  return String(weathers[index].dt);
 }
 
 String OpenWeatherMapClient::getCity(int index) {
@@ -192,35 +236,35 @@ String OpenWeatherMapClient::getCountry(int index) {
 }
 
 String OpenWeatherMapClient::getTemp(int index) {
-  return weathers[index].temp;
+  return formatFixed(weathers[index].temp, 1);
 }
 
 String OpenWeatherMapClient::getTempRounded(int index) {
-  return roundValue(getTemp(index));
+  return roundValue(weathers[index].temp);
 }
 
 String OpenWeatherMapClient::getHumidity(int index) {
-  return weathers[index].humidity;
+  return String(weathers[index].humidity);
 }
 
 String OpenWeatherMapClient::getHumidityRounded(int index) {
-  return roundValue(getHumidity(index));
+  return String(weathers[index].humidity);
 }
 
 String OpenWeatherMapClient::getCondition(int index) {
-  return weathers[index].condition;
+  return CONDITION_NAMES[weathers[index].condition];
 }
 
 String OpenWeatherMapClient::getWind(int index) {
-  return weathers[index].wind;
+  return formatFixed(weathers[index].wind, 1);
 }
 
 String OpenWeatherMapClient::getWindRounded(int index) {
-  return roundValue(getWind(index));
+  return roundValue(weathers[index].wind);
 }
 
 String OpenWeatherMapClient::getWeatherId(int index) {
-  return weathers[index].weatherId;
+  return String(weathers[index].weatherId);
 }
 
 String OpenWeatherMapClient::getDescription(int index) {
@@ -228,32 +272,43 @@ String OpenWeatherMapClient::getDescription(int index) {
 }
 
 String OpenWeatherMapClient::getIcon(int index) {
-  return weathers[index].icon;
+  if (weathers[index].icon == ICON_UNKNOWN) {
+    return "";
+  }
+  return String(ICON_CODES[weathers[index].icon]) + (weathers[index].night ? "n" : "d");
 }
 
 boolean OpenWeatherMapClient::getCached() {
-  return weathers[0].cached;
+  return cached;
 }
 
 String OpenWeatherMapClient::getMyCityIDs() {
-  return myCityIDs;
+  return myCityIDs.c_str();
 }
 
 String OpenWeatherMapClient::getError() {
-  return weathers[0].error;
+  return error.c_str();
 }
 
 String OpenWeatherMapClient::getSunrise() {
-  return weathers[0].sunrise;
+  return String(weathers[0].sunrise);
 }
 
 String OpenWeatherMapClient::getSunset() {
+  return String(weathers[0].sunset);
+}
+
+unsigned long OpenWeatherMapClient::getSunriseEpoch() {
+  return weathers[0].sunrise;
+}
+
+unsigned long OpenWeatherMapClient::getSunsetEpoch() {
   return weathers[0].sunset;
 }
 
 String OpenWeatherMapClient::getWeatherIcon(int index)
 {
-  int id = getWeatherId(index).toInt();
+  int id = weathers[index].weatherId;
   String W = ")";
   switch(id)
   {
@@ -24,51 +24,80 @@ SOFTWARE.
 #pragma once
 #include <ESP8266WiFi.h>
 #include "libs/ArduinoJson/ArduinoJson.h"
+#include "JsonBufferPool.h"
+#include "AsyncHttpClient.h"
+#include "ScratchArena.h"
+#include "FixedString.h"
+
+#define WEATHER_CITY_COUNT 5
+#define WEATHER_CITY_SIZE 32          // UTF-8 bytes, longer names are cut
+#define WEATHER_DESCRIPTION_SIZE 48   // localized, UTF-8 bytes
 
 class OpenWeatherMapClient {
 
 private:
-  String myCityIDs = "";
-  String myApiKey = "";
-  String units = "";
-  String lang = "";
+  FixedString<64> myCityIDs;
+  FixedString<60> myApiKey;
+  FixedString<8> units;
+  FixedString<8> lang;
   
   const char* servername = "api.openweathermap.org";  // remote server we will connect to
-  String result;
+  AsyncHttpClient httpClient;
+  char headerBlock[HTTP_HEADER_BLOCK_SIZE] = "";
+
+  // OpenWeatherMap's "main" texts and icon codes, stored as their index
+  enum WeatherCondition {
+    CONDITION_UNKNOWN, CONDITION_THUNDERSTORM, CONDITION_DRIZZLE, CONDITION_RAIN, CONDITION_SNOW,
+    CONDITION_MIST, CONDITION_SMOKE, CONDITION_HAZE, CONDITION_DUST, CONDITION_FOG, CONDITION_SAND,
+    CONDITION_ASH, CONDITION_SQUALL, CONDITION_TORNADO, CONDITION_CLEAR, CONDITION_CLOUDS, CONDITION_COUNT
+  };
+  enum WeatherIcon {
+    ICON_UNKNOWN, ICON_CLEAR, ICON_FEW_CLOUDS, ICON_SCATTERED_CLOUDS, ICON_BROKEN_CLOUDS,
+    ICON_SHOWER_RAIN, ICON_RAIN, ICON_THUNDERSTORM, ICON_SNOW, ICON_MIST, ICON_COUNT
+  };
+  static const char* const CONDITION_NAMES[CONDITION_COUNT];
+  static const char* const ICON_CODES[ICON_COUNT];
 
+  // Temperature and wind are in tenths, coordinates in 1/10000 degree
   typedef struct {
-    String lat;
-    String lon;
-    String dt;
-    String city;
-    String country;
-    String temp;
-    String humidity;
-    String condition;
-    String wind;
-    String weatherId;
-    String description;
-    String icon;
-    boolean cached;
-    String error;
-	  String sunrise;
-	  String sunset;
+    int32_t lat;
+    int32_t lon;
+    uint32_t dt;
+    uint32_t sunrise;
+    uint32_t sunset;
+    int16_t temp;
+    uint16_t wind;
+    uint16_t weatherId;
+    uint8_t humidity;
+    uint8_t condition;
+    uint8_t icon;
+    boolean night;
+    char country[3];
+    char city[WEATHER_CITY_SIZE];
+    char description[WEATHER_DESCRIPTION_SIZE];
   } weather;
 
-  weather weathers[5];
+  weather weathers[WEATHER_CITY_COUNT];
+  boolean cached = false;
+  FixedString<64> error;
 
-  String roundValue(String value);
+  String roundValue(int tenths);
+  String formatFixed(long value, int decimals);
+  void processWeather();
+  static void copyText(char* dest, size_t size, const char* text);
+  static uint8_t lookup(const char* const table[], uint8_t count, const char* text, size_t length);
+  void renderHeaders();
   
 public:
-  OpenWeatherMapClient(String ApiKey, int CityIDs[], int cityCount, boolean isMetric, String language);
+  OpenWeatherMapClient(const char* ApiKey, int CityIDs[], int cityCount, boolean isMetric, const char* language);
   void updateWeather();
-  void updateWeatherApiKey(String ApiKey);
+  void handle();
+  boolean isBusy();
+  void updateWeatherApiKey(const char* ApiKey);
   void updateCityIdList(int CityIDs[], int cityCount);
-  void updateLanguage(String language);
+  void updateLanguage(const char* language);
   void setMetric(boolean isMetric);
 
-  String getWeatherResults();
-
   String getLat(int index);
   String getLon(int index);
   String getDt(int index);
@@ -90,4 +119,6 @@ public:
   String getError();
   String getSunrise();
   String getSunset();
+  unsigned long getSunriseEpoch();
+  unsigned long getSunsetEpoch();
 };
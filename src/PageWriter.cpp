@@ -0,0 +1,150 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "PageWriter.h"
+
+PageWriter::PageWriter(ESP8266WebServer &server) : server(server) {
+}
+
+// Response headers of a page that is never cached, length unknown up front
+void PageWriter::begin() {
+  server.sendHeader("Cache-Control", "no-cache, no-store");
+  server.sendHeader("Pragma", "no-cache");
+  server.sendHeader("Expires", "-1");
+  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server.send(200, "text/html", "");
+}
+
+// Sends what is left, the closing empty chunk and closes the connection
+void PageWriter::end() {
+  flush();
+  server.sendContent("");
+  server.client().stop();
+}
+
+size_t PageWriter::write(uint8_t c) {
+  if (length == sizeof(buffer)) {
+    flush();
+  }
+  buffer[length++] = c;
+  return 1;
+}
+
+size_t PageWriter::write(const uint8_t* data, size_t size) {
+  size_t left = size;
+  while (left > 0) {
+    if (length == sizeof(buffer)) {
+      flush();
+    }
+    size_t count = min(left, sizeof(buffer) - length);
+    memcpy(buffer + length, data, count);
+    length += count;
+    data += count;
+    left -= count;
+  }
+  return size;
+}
+
+void PageWriter::flush() {
+  if (length > 0) {
+    server.sendContent(buffer, length); // an empty chunk would end the page
+    length = 0;
+  }
+}
+
+// printf straight into the buffer; Print::printf would take longer output to the heap
+void PageWriter::format(const char* pattern, ...) {
+  va_list args;
+  va_start(args, pattern);
+  int needed = vsnprintf(buffer + length, sizeof(buffer) - length, pattern, args);
+  va_end(args);
+  if (needed < 0) {
+    return;
+  }
+  if ((size_t)needed < sizeof(buffer) - length) {
+    length += needed;
+    return;
+  }
+  // did not fit behind what is waiting, start a new chunk with it
+  buffer[length] = '\0';
+  flush();
+  va_start(args, pattern);
+  needed = vsnprintf(buffer, sizeof(buffer), pattern, args);
+  va_end(args);
+  if ((size_t)needed >= sizeof(buffer)) {
+    Serial.println("Page text longer than a chunk, cut");
+    needed = sizeof(buffer) - 1;
+  }
+  length = needed;
+}
+
+// Copies a template from flash, handing every %NAME% to field to write its value;
+// a '%' that does not start a field is copied as it is
+void PageWriter::printTemplate(PGM_P text, PageField field) {
+  char name[PAGE_FIELD_SIZE + 1];
+  size_t inx = 0;
+  char c;
+  while ((c = pgm_read_byte(text + inx)) != '\0') {
+    inx++;
+    if (c != '%') {
+      write(c);
+      continue;
+    }
+    size_t nameLength = 0;
+    while (nameLength < PAGE_FIELD_SIZE) {
+      char next = pgm_read_byte(text + inx + nameLength);
+      if (!isupper(next) && !isdigit(next) && next != '_') {
+        break;
+      }
+      name[nameLength++] = next;
+    }
+    if (nameLength > 0 && pgm_read_byte(text + inx + nameLength) == '%') {
+      name[nameLength] = '\0';
+      field(*this, name);
+      inx += nameLength + 1;
+    } else {
+      write(c);
+    }
+  }
+}
+
+// Copies a list of <option>value</option> from flash, marking the selected value
+void PageWriter::printOptions(PGM_P options, const char* selected) {
+  static const char OPTION[] = "<option>";
+  const size_t optionLength = sizeof(OPTION) - 1;
+  size_t selectedLength = strlen(selected);
+  size_t inx = 0;
+  char c;
+  while ((c = pgm_read_byte(options + inx)) != '\0') {
+    if (c == '<' && strncmp_P(OPTION, options + inx, optionLength) == 0
+        && strncmp_P(selected, options + inx + optionLength, selectedLength) == 0
+        && pgm_read_byte(options + inx + optionLength + selectedLength) == '<') {
+      print("<option selected>");
+      inx += optionLength;
+      continue;
+    }
+    write(c);
+    inx++;
+  }
+}
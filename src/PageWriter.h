@@ -0,0 +1,58 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <ESP8266WebServer.h>
+
+#define PAGE_CHUNK_SIZE 512   // bytes collected before a chunk goes out
+#define PAGE_FIELD_SIZE 24    // longest %NAME% recognised in a template
+
+class PageWriter;
+
+// Writes the value of one %NAME% field of a template
+typedef void (*PageField)(PageWriter &page, const char* name);
+
+// Sends a web page in chunks through a fixed buffer on the stack, so a page of
+// any length goes out without being built up in a String first. Templates in
+// flash are copied out with their %NAME% fields filled in on the way.
+class PageWriter : public Print {
+
+private:
+  ESP8266WebServer &server;
+  char buffer[PAGE_CHUNK_SIZE];
+  size_t length = 0;
+
+public:
+  PageWriter(ESP8266WebServer &server);
+  void begin();
+  void end();
+
+  using Print::write;
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* data, size_t size) override;
+  void flush() override;
+  void format(const char* pattern, ...) __attribute__ ((format (printf, 2, 3)));
+  void printTemplate(PGM_P text, PageField field);
+  void printOptions(PGM_P options, const char* selected);
+};
@@ -0,0 +1,116 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "PollScheduler.h"
+
+PollScheduler::PollScheduler() {
+  setIntervals(5, 60, 10, 60, 300);
+}
+
+void PollScheduler::setIntervals(int heating, int printing, int finishing, int idle, int offline) {
+  intervals[POLL_HEATING] = heating;
+  intervals[POLL_PRINTING] = printing;
+  intervals[POLL_FINISHING] = finishing;
+  intervals[POLL_IDLE] = idle;
+  intervals[POLL_OFFLINE] = offline;
+  for (int inx = 0; inx < POLL_PHASE_COUNT; inx++) {
+    if (intervals[inx] < 1) {
+      intervals[inx] = 1;
+    }
+  }
+}
+
+int PollScheduler::getInterval(PollPhase forPhase) {
+  return intervals[forPhase];
+}
+
+boolean PollScheduler::isHeating(int16_t actual, int16_t target) {
+  return target != PRINTER_TENTHS_UNKNOWN && target > 0 && actual < target - POLL_HEATING_MARGIN;
+}
+
+PollPhase PollScheduler::classify(boolean operational, const PrinterState &printer) {
+  if (printer.isPSUoff || !operational) {
+    return POLL_OFFLINE;
+  }
+  if (isHeating(printer.toolTemp, printer.toolTargetTemp) || isHeating(printer.bedTemp, printer.bedTargetTemp)) {
+    return POLL_HEATING;
+  }
+  if (!printer.isPrinting) {
+    return POLL_IDLE;
+  }
+  if (printer.getCompletionPercent() >= POLL_FINISHING_PERCENT) {
+    return POLL_FINISHING;
+  }
+  return POLL_PRINTING;
+}
+
+void PollScheduler::setPhase(PollPhase newPhase) {
+  if (newPhase == phase) {
+    return;
+  }
+  Serial.printf("Printer poll phase: %s -> %s (every %ds)\n", phaseName(phase), phaseName(newPhase), intervals[newPhase]);
+  phase = newPhase;
+}
+
+boolean PollScheduler::isDue() {
+  return pollPending || millis() - lastPoll >= (unsigned long)intervals[phase] * 1000;
+}
+
+void PollScheduler::polled() {
+  lastPoll = millis();
+  pollPending = false;
+  polls++;
+}
+
+// Poll on the next check regardless of the interval (start up, settings changed)
+void PollScheduler::pollNow() {
+  pollPending = true;
+}
+
+PollPhase PollScheduler::getPhase() {
+  return phase;
+}
+
+String PollScheduler::getPhaseName() {
+  return phaseName(phase);
+}
+
+const char* PollScheduler::phaseName(PollPhase forPhase) {
+  switch (forPhase) {
+    case POLL_OFFLINE:
+      return "offline";
+    case POLL_HEATING:
+      return "heating";
+    case POLL_PRINTING:
+      return "printing";
+    case POLL_FINISHING:
+      return "finishing";
+    default:
+      return "idle";
+  }
+}
+
+unsigned long PollScheduler::getPolls() {
+  return polls;
+}
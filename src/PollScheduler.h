@@ -0,0 +1,70 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <Arduino.h>
+#include "PrinterState.h"
+
+#define POLL_FINISHING_PERCENT 95   // progress from which the end of a print is watched closely
+#define POLL_HEATING_MARGIN 30      // tenths of a degree below target that still count as heating
+
+enum PollPhase {
+  POLL_OFFLINE,
+  POLL_IDLE,
+  POLL_HEATING,
+  POLL_PRINTING,
+  POLL_FINISHING,
+  POLL_PHASE_COUNT
+};
+
+// Picks the printer poll interval from what the printer is doing: fast while
+// heating and at the end of a print, slow in the middle of a print, very slow
+// while the printer is offline or its PSU is off.
+class PollScheduler {
+
+private:
+  int intervals[POLL_PHASE_COUNT];  // seconds
+  PollPhase phase = POLL_IDLE;
+  unsigned long lastPoll = 0;
+  boolean pollPending = true;
+  unsigned long polls = 0;
+
+  boolean isHeating(int16_t actual, int16_t target);
+  const char* phaseName(PollPhase forPhase);
+
+public:
+  PollScheduler();
+  void setIntervals(int heating, int printing, int finishing, int idle, int offline);
+  int getInterval(PollPhase forPhase);
+
+  PollPhase classify(boolean operational, const PrinterState &printer);
+  void setPhase(PollPhase newPhase);
+  boolean isDue();
+  void polled();
+  void pollNow();
+
+  PollPhase getPhase();
+  String getPhaseName();
+  unsigned long getPolls();
+};
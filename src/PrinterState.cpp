@@ -0,0 +1,187 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "PrinterState.h"
+
+void PrinterState::reset() {
+  averagePrintTime = PRINTER_VALUE_UNKNOWN;
+  estimatedPrintTime = PRINTER_VALUE_UNKNOWN;
+  lastPrintTime = PRINTER_VALUE_UNKNOWN;
+  progressPrintTime = PRINTER_VALUE_UNKNOWN;
+  progressPrintTimeLeft = PRINTER_VALUE_UNKNOWN;
+  fileSize = PRINTER_VALUE_UNKNOWN;
+  progressFilepos = PRINTER_VALUE_UNKNOWN;
+  filamentLength = PRINTER_VALUE_UNKNOWN;
+  progressCompletion = PRINTER_TENTHS_UNKNOWN;
+  toolTemp = PRINTER_TENTHS_UNKNOWN;
+  toolTargetTemp = PRINTER_TENTHS_UNKNOWN;
+  bedTemp = PRINTER_TENTHS_UNKNOWN;
+  bedTargetTemp = PRINTER_TENTHS_UNKNOWN;
+  state = PRINTER_UNKNOWN;
+  isPrinting = false;
+  isPSUoff = false;
+  fileName[0] = '\0';
+  stateText[0] = '\0';
+}
+
+void PrinterState::setFileName(const char* name) {
+  if (name == NULL) {
+    name = "";
+  }
+  strncpy(fileName, name, PRINTER_FILE_NAME_SIZE - 1);
+  fileName[PRINTER_FILE_NAME_SIZE - 1] = '\0';
+}
+
+// Keeps OctoPrint's own wording next to the status parsed from it; NULL or "" is unknown
+void PrinterState::setState(const char* text) {
+  if (text == NULL) {
+    text = "";
+  }
+  state = parseStatus(text);
+  strncpy(stateText, text, PRINTER_STATE_TEXT_SIZE - 1);
+  stateText[PRINTER_STATE_TEXT_SIZE - 1] = '\0';
+}
+
+// e.g. "Printing from SD" rather than just "Printing"
+const char* PrinterState::getStateText() const {
+  if (stateText[0] != '\0') {
+    return stateText;
+  }
+  return getStatusName(state);
+}
+
+// Whole percent, cut like the String value used to be with toInt()
+int PrinterState::getCompletionPercent() const {
+  if (progressCompletion == PRINTER_TENTHS_UNKNOWN) {
+    return 0;
+  }
+  return progressCompletion / 10;
+}
+
+int32_t PrinterState::getPrintTimeLeft() const {
+  if (getCompletionPercent() == 100 || progressPrintTimeLeft == PRINTER_VALUE_UNKNOWN) {
+    return 0; // Print is done so this should be 0 this is a fix for OctoPrint
+  }
+  return progressPrintTimeLeft;
+}
+
+// "" and null (also reported as "") are unknown
+int32_t PrinterState::parseWhole(const char* value) {
+  if (value == NULL || value[0] == '\0') {
+    return PRINTER_VALUE_UNKNOWN;
+  }
+  double number = atof(value);
+  if (number >= INT32_MAX) {
+    return INT32_MAX;
+  }
+  if (number <= -INT32_MAX) {
+    return -INT32_MAX;
+  }
+  return (int32_t)number;
+}
+
+// Progress is cut instead of rounded so 99.96% does not show as done
+int16_t PrinterState::parseTenths(const char* value, boolean rounded) {
+  if (value == NULL || value[0] == '\0') {
+    return PRINTER_TENTHS_UNKNOWN;
+  }
+  double tenths = atof(value) * 10;
+  if (rounded) {
+    tenths += tenths < 0 ? -0.5 : 0.5;
+  }
+  if (tenths >= INT16_MAX) {
+    return INT16_MAX;
+  }
+  if (tenths <= -INT16_MAX) {
+    return -INT16_MAX;
+  }
+  return (int16_t)tenths;
+}
+
+// OctoPrint's state text, e.g. "Printing from SD" or "Offline after error: ..."
+PrinterStatus PrinterState::parseStatus(const char* text) {
+  if (text == NULL || text[0] == '\0') {
+    return PRINTER_UNKNOWN;
+  }
+  if (strcmp(text, "Operational") == 0) {
+    return PRINTER_OPERATIONAL;
+  }
+  if (strncmp(text, "Printing", 8) == 0 || strcmp(text, "Starting") == 0 || strcmp(text, "Finishing") == 0 || strcmp(text, "Resuming") == 0) {
+    return PRINTER_PRINTING;
+  }
+  if (strcmp(text, "Paused") == 0 || strcmp(text, "Pausing") == 0) {
+    return PRINTER_PAUSED;
+  }
+  if (strcmp(text, "Cancelling") == 0) {
+    return PRINTER_CANCELLING;
+  }
+  if (strncmp(text, "Error", 5) == 0 || strncmp(text, "Offline after error", 19) == 0) {
+    return PRINTER_ERROR;
+  }
+  if (strncmp(text, "Offline", 7) == 0 || strcmp(text, "Closed") == 0) {
+    return PRINTER_OFFLINE;
+  }
+  if (strncmp(text, "Opening", 7) == 0 || strncmp(text, "Connecting", 10) == 0 || strncmp(text, "Detecting", 9) == 0) {
+    return PRINTER_CONNECTING;
+  }
+  return PRINTER_UNKNOWN;
+}
+
+String PrinterState::formatWhole(int32_t value) {
+  if (value == PRINTER_VALUE_UNKNOWN) {
+    return "";
+  }
+  return String(value);
+}
+
+String PrinterState::formatTenths(int16_t value) {
+  if (value == PRINTER_TENTHS_UNKNOWN) {
+    return "";
+  }
+  if (value % 10 == 0) {
+    return String(value / 10);
+  }
+  return String(value / 10.0f, 1);
+}
+
+// Whole degrees for the display, unknown shows as 0
+int PrinterState::roundTenths(int16_t value) {
+  if (value == PRINTER_TENTHS_UNKNOWN) {
+    return 0;
+  }
+  return (value + (value < 0 ? -5 : 5)) / 10;
+}
+
+const char* PrinterState::getStatusName(PrinterStatus status) {
+  switch (status) {
+    case PRINTER_OFFLINE: return "Offline";
+    case PRINTER_CONNECTING: return "Connecting";
+    case PRINTER_OPERATIONAL: return "Operational";
+    case PRINTER_PRINTING: return "Printing";
+    case PRINTER_PAUSED: return "Paused";
+    case PRINTER_CANCELLING: return "Cancelling";
+    case PRINTER_ERROR: return "Error";
+    default: return "";
+  }
+}
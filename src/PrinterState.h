@@ -0,0 +1,81 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <Arduino.h>
+
+#define PRINTER_FILE_NAME_SIZE 64           // longer file names are cut
+#define PRINTER_STATE_TEXT_SIZE 48          // longer state texts are cut
+#define PRINTER_VALUE_UNKNOWN INT32_MIN     // whole values not (yet) reported
+#define PRINTER_TENTHS_UNKNOWN INT16_MIN    // fixed point values not (yet) reported
+
+enum PrinterStatus {
+  PRINTER_UNKNOWN,
+  PRINTER_OFFLINE,
+  PRINTER_CONNECTING,
+  PRINTER_OPERATIONAL,
+  PRINTER_PRINTING,
+  PRINTER_PAUSED,
+  PRINTER_CANCELLING,
+  PRINTER_ERROR
+};
+
+// What the printer server last reported, converted to numbers once when the
+// response is read instead of every time a frame or page shows it.
+// Temperatures and progress are in tenths (2105 = 210.5), times in seconds.
+struct PrinterState {
+  int32_t averagePrintTime;
+  int32_t estimatedPrintTime;
+  int32_t lastPrintTime;
+  int32_t progressPrintTime;
+  int32_t progressPrintTimeLeft;
+  int32_t fileSize;
+  int32_t progressFilepos;
+  int32_t filamentLength;             // mm
+  int16_t progressCompletion;
+  int16_t toolTemp;
+  int16_t toolTargetTemp;
+  int16_t bedTemp;
+  int16_t bedTargetTemp;
+  PrinterStatus state;
+  boolean isPrinting;
+  boolean isPSUoff;
+  char fileName[PRINTER_FILE_NAME_SIZE];
+  char stateText[PRINTER_STATE_TEXT_SIZE]; // as the server words it, "" if it only gave a status
+
+  void reset();
+  void setFileName(const char* name);
+  void setState(const char* text);
+  const char* getStateText() const;
+  int getCompletionPercent() const;
+  int32_t getPrintTimeLeft() const;
+
+  static int32_t parseWhole(const char* value);
+  static int16_t parseTenths(const char* value, boolean rounded = true);
+  static PrinterStatus parseStatus(const char* text);
+  static String formatWhole(int32_t value);
+  static String formatTenths(int16_t value);
+  static int roundTenths(int16_t value);
+  static const char* getStatusName(PrinterStatus status);
+};
@@ -0,0 +1,116 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "ReachabilityProbe.h"
+
+ReachabilityProbe reachability;
+
+ReachabilityProbe::ReachabilityProbe() {
+  for (int inx = 0; inx < REACH_CACHE_SIZE; inx++) {
+    entries[inx].host[0] = '\0';
+    entries[inx].port = 0;
+    entries[inx].reachable = false;
+    entries[inx].checkedAt = 0;
+  }
+}
+
+// finds the entry for host:port, otherwise recycles the oldest one
+ReachabilityProbe::ProbeEntry* ReachabilityProbe::findEntry(const char* host, int port) {
+  ProbeEntry* oldest = &entries[0];
+  for (int inx = 0; inx < REACH_CACHE_SIZE; inx++) {
+    if (entries[inx].port == port && strcmp(entries[inx].host, host) == 0) {
+      return &entries[inx];
+    }
+    if ((long)(entries[inx].checkedAt - oldest->checkedAt) < 0) {
+      oldest = &entries[inx];
+    }
+  }
+  strncpy(oldest->host, host, sizeof(oldest->host) - 1);
+  oldest->host[sizeof(oldest->host) - 1] = '\0';
+  oldest->port = port;
+  oldest->checkedAt = millis() - REACH_CACHE_TTL; // expired
+  return oldest;
+}
+
+// false only when the host refused a connection in the last few seconds;
+// hosts whose address is not known yet or that did not answer within the
+// probe timeout are left to the request itself
+boolean ReachabilityProbe::isReachable(const char* host, int port) {
+  IPAddress address;
+  if (dnsCache.resolve(host, address) != DNS_RESOLVED) {
+    return true;
+  }
+  ProbeEntry* entry = findEntry(host, port);
+  if (millis() - entry->checkedAt < REACH_CACHE_TTL) {
+    cached++;
+    return entry->reachable;
+  }
+
+  probes++;
+  unsigned long started = millis();
+  boolean connected = connectionPool.prepare(host, address, port, REACH_PROBE_TIMEOUT);
+  unsigned long took = millis() - started;
+  entry->checkedAt = millis();
+  // a refusal comes back before the timeout; running into it only says the
+  // handshake is slower than the probe allows, which is not an answer either way
+  entry->reachable = connected || took >= REACH_PROBE_TIMEOUT;
+  if (!connected && entry->reachable) {
+    slow++;
+    Serial.printf("%s:%d did not answer the probe within %d ms, trying the request\n", host, port, REACH_PROBE_TIMEOUT);
+  } else if (!connected) {
+    unreachable++;
+    Serial.printf("%s:%d refused the connection (probe took %lu ms)\n", host, port, took);
+  }
+  return entry->reachable;
+}
+
+// drops the cached result, e.g. when the settings change
+void ReachabilityProbe::forget(const char* host, int port) {
+  for (int inx = 0; inx < REACH_CACHE_SIZE; inx++) {
+    if (entries[inx].port == port && strcmp(entries[inx].host, host) == 0) {
+      entries[inx].host[0] = '\0';
+      entries[inx].port = 0;
+    }
+  }
+}
+
+void ReachabilityProbe::printStats() {
+  Serial.printf("Reachability: %lu probes, %lu answered from cache, %lu refused, %lu slow\n", probes, cached, unreachable, slow);
+}
+
+unsigned long ReachabilityProbe::getProbes() {
+  return probes;
+}
+
+unsigned long ReachabilityProbe::getCached() {
+  return cached;
+}
+
+unsigned long ReachabilityProbe::getUnreachable() {
+  return unreachable;
+}
+
+unsigned long ReachabilityProbe::getSlow() {
+  return slow;
+}
@@ -0,0 +1,70 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <ESP8266WiFi.h>
+#include "HttpConnectionPool.h"
+#include "DnsCache.h"
+
+#define REACH_CACHE_SIZE 2          // printer host plus one spare
+#define REACH_PROBE_TIMEOUT 300     // ms the probe waits; a slower host is left to the request's own timeout
+#define REACH_CACHE_TTL 5000        // ms a probe result is trusted
+
+// Cheap check that a LAN host answers on its port before a full request is
+// built. The probe is a TCP connect with a short timeout; when it succeeds
+// the connection is parked in the pool so the request that follows reuses it.
+// Only a refused connect counts as down: a host that is merely slow to answer
+// (VPN, busy Pi) runs into the timeout and is left to the real request.
+class ReachabilityProbe {
+
+private:
+  typedef struct {
+    char host[100];
+    int port;
+    boolean reachable;
+    unsigned long checkedAt;
+  } ProbeEntry;
+
+  ProbeEntry entries[REACH_CACHE_SIZE];
+
+  unsigned long probes = 0;
+  unsigned long cached = 0;
+  unsigned long unreachable = 0;
+  unsigned long slow = 0;
+
+  ProbeEntry* findEntry(const char* host, int port);
+
+public:
+  ReachabilityProbe();
+  boolean isReachable(const char* host, int port);
+  void forget(const char* host, int port);
+
+  void printStats();
+  unsigned long getProbes();
+  unsigned long getCached();
+  unsigned long getUnreachable();
+  unsigned long getSlow();
+};
+
+extern ReachabilityProbe reachability;
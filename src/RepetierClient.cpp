@@ -27,202 +27,527 @@ SOFTWARE.
 
 #include "RepetierClient.h"
 
-RepetierClient::RepetierClient(String ApiKey, String server, int port, String user, String pass, boolean psu) {
+// Every printer of listPrinter is walked but only the one with our slug is kept,
+// and of stateList only the object under our slug ("$") is read
+const JsonPath RepetierClient::LIST_PATHS[] = {
+  {"*.slug", LIST_SLUG},
+  {"*.job", LIST_JOB},
+  {"*.totalLines", LIST_TOTAL_LINES},
+  {"*.online", LIST_ONLINE},
+  {"*.done", LIST_DONE},
+  {"*.linesSend", LIST_LINES_SEND},
+  {"*.printTime", LIST_PRINT_TIME},
+  {"*.printedTimeComp", LIST_PRINTED_TIME},
+  {"*", LIST_ELEMENT}
+};
+
+const JsonPath RepetierClient::STATE_PATHS[] = {
+  {"$.extruder.0.tempRead", STATE_TOOL_TEMP},
+  {"$.extruder.0.tempSet", STATE_TOOL_TARGET},
+  {"$.heatedBeds.0.tempRead", STATE_BED_TEMP},
+  {"$.heatedBeds.0.tempSet", STATE_BED_TARGET}
+};
+
+// Socket replies carry the same documents under "data", whichever callback they answer;
+// events are buffered and parsed separately
+const JsonPath RepetierClient::PUSH_PATHS[] = {
+  {"callback_id", PUSH_CALLBACK},
+  {"data.*.slug", LIST_SLUG},
+  {"data.*.job", LIST_JOB},
+  {"data.*.totalLines", LIST_TOTAL_LINES},
+  {"data.*.online", LIST_ONLINE},
+  {"data.*.done", LIST_DONE},
+  {"data.*.linesSend", LIST_LINES_SEND},
+  {"data.*.printTime", LIST_PRINT_TIME},
+  {"data.*.printedTimeComp", LIST_PRINTED_TIME},
+  {"data.*", LIST_ELEMENT},
+  {"data.$.extruder.0.tempRead", STATE_TOOL_TEMP},
+  {"data.$.extruder.0.tempSet", STATE_TOOL_TARGET},
+  {"data.$.heatedBeds.0.tempRead", STATE_BED_TEMP},
+  {"data.$.heatedBeds.0.tempSet", STATE_BED_TARGET}
+};
+
+RepetierClient::RepetierClient(const char* ApiKey, const char* server, int port, const char* user, const char* pass, boolean psu) : breaker("Repetier"),
+    listExtractor(LIST_PATHS, sizeof(LIST_PATHS) / sizeof(JsonPath), onValue, this),
+    stateExtractor(STATE_PATHS, sizeof(STATE_PATHS) / sizeof(JsonPath), onValue, this),
+    pushExtractor(PUSH_PATHS, sizeof(PUSH_PATHS) / sizeof(JsonPath), onPushValue, this) {
+  printerData.reset();
+  staged.reset();
+  resetPushScan();
+  pushClient.setStream(&pushExtractor);
   updatePrintClient(ApiKey, server, port, user, pass, psu);
 }
 
-void RepetierClient::updatePrintClient(String ApiKey, String server, int port, String user, String pass, boolean psu) {
-  server.toCharArray(myServer, 100);
+void RepetierClient::updatePrintClient(const char* ApiKey, const char* server, int port, const char* user, const char* pass, boolean psu) {
+  if (strcmp(server, myServer) != 0 || port != myPort || myApiKey != ApiKey) {
+    connectionPool.close(myServer, myPort); // do not keep a connection to the old server around
+    pushClient.close(); // reopened against the new settings
+    pushAttempted = false;
+    breaker.reset();
+    reachability.forget(myServer, myPort);
+    resetPrintData(); // belongs to the old server
+  }
+  snprintf(myServer, sizeof(myServer), "%s", server);
   myApiKey = ApiKey;
   myPort = port;
-  encodedAuth = "";
-  if (user != "") {
-    String userpass = user + ":" + pass;
+  encodedAuth.clear();
+  if (user[0] != '\0') {
     base64 b64;
-    encodedAuth = b64.encode(userpass, true);
+    encodedAuth = b64.encode(String(user) + ":" + pass, true);
   }
   pollPsu = psu;
+  renderHeaders();
+}
+
+// The headers only change with the settings, so they are rendered once instead of per request
+void RepetierClient::renderHeaders() {
+  int length = snprintf(headerBlock, sizeof(headerBlock),
+    "Host: %s:%d\r\nX-Api-Key: %s\r\n%s%s%sUser-Agent: ArduinoWiFi/1.1\r\nConnection: keep-alive\r\n",
+    myServer, myPort, myApiKey.c_str(),
+    encodedAuth != "" ? "Authorization: Basic " : "", encodedAuth.c_str(), encodedAuth != "" ? "\r\n" : "");
+  if (length >= (int)sizeof(headerBlock)) {
+    Serial.println("Repetier request headers too long, truncated");
+  }
+  Serial.printf("Repetier request headers rendered: %u bytes\n", (unsigned)strlen(headerBlock));
 }
 
 boolean RepetierClient::validate() {
   boolean rtnValue = false;
-  printerData.error = "";
+  printerError.clear();
   if (String(myServer) == "") {
-    printerData.error += "Server address is required; ";
+    printerError += "Server address is required; ";
   }
   if (myApiKey == "") {
-    printerData.error += "ApiKey is required; ";
+    printerError += "ApiKey is required; ";
   }
-  if (printerData.error == "") {
+  if (printerError == "") {
     rtnValue = true;
   }
   return rtnValue;
 }
 
-WiFiClient RepetierClient::getSubmitRequest(String apiGetData) {
-  WiFiClient printClient;
-  printClient.setTimeout(5000);
-
+boolean RepetierClient::getSubmitRequest(const char* apiGetData, const ResponseFingerprint &fingerprint, JsonStreamExtractor &extractor) {
   Serial.println("Getting Repetier Data via GET");
   Serial.println(apiGetData);
-  result = "";
-  if (printClient.connect(myServer, myPort)) {  //starts client connection, checks for connection
-    printClient.println(apiGetData);
-    printClient.println("Host: " + String(myServer) + ":" + String(myPort));
-    printClient.println("X-Api-Key: " + myApiKey);
-    if (encodedAuth != "") {
-      printClient.print("Authorization: ");
-      printClient.println("Basic " + encodedAuth);
-    }
-    printClient.println("User-Agent: ArduinoWiFi/1.1");
-    printClient.println("Connection: close");
-    if (printClient.println() == 0) {
-      Serial.println("Connection to " + String(myServer) + ":" + String(myPort) + " failed.");
-      Serial.println();
-      resetPrintData();
-      printerData.error = "Connection to " + String(myServer) + ":" + String(myPort) + " failed.";
-      return printClient;
-    }
-  } 
-  else {
-    Serial.println("Connection to Repetier failed: " + String(myServer) + ":" + String(myPort)); //error message if no client connect
-    Serial.println();
-    resetPrintData();
-    printerData.error = "Connection to Repetier failed: " + String(myServer) + ":" + String(myPort);
-    return printClient;
-  }
-/*
-  // Check HTTP status
-  char status[32] = {0};
-  printClient.readBytesUntil('\r', status, sizeof(status));
-  if (strcmp(status, "HTTP/1.1 200 OK") != 0) {
+  return httpClient.begin(myServer, myPort, scratch.format("%s HTTP/1.1", apiGetData), headerBlock, &fingerprint, NULL, &extractor);
+}
+
+// Checks the finished request; returns false (with printerError set) if there is nothing to parse
+boolean RepetierClient::checkResponse() {
+  if (httpClient.isFailed()) {
+    breaker.recordFailure();
+    markStale(httpClient.getError().c_str());
+    return false;
+  }
+  if (httpClient.getStatusCode() >= 500) {
+    breaker.recordFailure();
+  } else {
+    breaker.recordSuccess();
+  }
+  if (httpClient.getStatusCode() != 200 && httpClient.getStatusCode() != 304) {
     Serial.print(F("Unexpected response: "));
-    Serial.println(status);
-    printerData.state = "";
-    printerData.error = "Response: " + String(status);
-    return printClient;
+    Serial.println(httpClient.getStatusLine());
+    printerData.state = PRINTER_UNKNOWN;
+    printerError = scratch.format("Response: %s", httpClient.getStatusLine());
+    clearFingerprints();
+    return false;
   }
+  updatedAt = millis();
+  return true;
+}
 
-  // Skip HTTP headers
-  char endOfHeaders[] = "\r\n\r\n";
-  if (!printClient.find(endOfHeaders)) {
-    Serial.println(F("Invalid response"));
-    printerData.error = "Invalid response from " + String(myServer) + ":" + String(myPort);
-    printerData.state = "";
+// A failed request keeps the last known printerData, flagged by the error and its
+// age, so one dropped poll does not blank the display. It is only thrown away once
+// the breaker has backed off as far as it goes, or the settings change.
+void RepetierClient::markStale(const char* error) {
+  if (breaker.isAtMaxBackoff() && updatedAt != 0) {
+    Serial.println("Printer down for too long, dropping its last known state");
+    resetPrintData();
   }
-*/
-  return printClient;
+  clearFingerprints();
+  printerError = error;
 }
 
+// Forget the last responses so the next ones are parsed even if identical
+void RepetierClient::clearFingerprints() {
+  httpClient.clearFingerprint(listFingerprint);
+  httpClient.clearFingerprint(stateFingerprint);
+}
 
 void RepetierClient::getPrinterJobResults() {
+  if (pollStep != STEP_IDLE) {
+    return; // previous poll still running
+  }
+  if (!breaker.allowRequest()) {
+    return; // host is down, keep serving the last known state until the retry time
+  }
   if (!validate()) {
     return;
   }
+  if (isPushActive()) {
+    return; // printer list and temperatures arrive over the socket
+  }
+  if (!reachability.isReachable(myServer, myPort)) {
+    // a host refusing connections costs one short probe instead of a full request
+    breaker.recordFailure();
+    markStale(scratch.format("Connection refused: %s:%d", myServer, myPort));
+    return;
+  }
   //**** get the Printer Job status
-  String apiGetData = "GET /printer/api/?a=listPrinter&apikey=" + myApiKey;
-  WiFiClient printClient = getSubmitRequest(apiGetData);
-  if (printerData.error != "") {
+  const char* apiGetData = scratch.format("GET /printer/api/?a=listPrinter&apikey=%s", myApiKey.c_str());
+  memset(&restList, 0, sizeof(restList));
+  if (getSubmitRequest(apiGetData, listFingerprint, listExtractor)) {
+    pollStep = STEP_LIST;
+  }
+}
+
+void RepetierClient::handle() {
+  handlePush();
+  if (pollStep == STEP_IDLE) {
+    return;
+  }
+  httpClient.handle();
+  if (httpClient.isBusy()) {
+    return;
+  }
+
+  PollStep finished = pollStep;
+  pollStep = STEP_IDLE;
+  boolean ok = checkResponse();
+  if (finished == STEP_LIST) {
+    if (ok && processPrinterList()) {
+      //**** get the Printer Temps and Stat
+      const char* apiGetData = scratch.format("GET /printer/api/?a=stateList&apikey=%s", myApiKey.c_str());
+      stateExtractor.setKey(printerName.c_str());
+      if (getSubmitRequest(apiGetData, stateFingerprint, stateExtractor)) {
+        pollStep = STEP_STATE;
+      }
+    }
+  } else if (finished == STEP_STATE) {
+    if (ok) {
+      processStateList();
+    }
+  }
+  if (pollStep == STEP_IDLE) {
+    httpClient.reset(); // free the response body
+  }
+}
+
+CircuitBreaker &RepetierClient::getCircuitBreaker() {
+  return breaker;
+}
+
+boolean RepetierClient::isBusy() {
+  return pollStep != STEP_IDLE;
+}
+
+boolean RepetierClient::isPushActive() {
+  return pushClient.isConnected() && pushLive && millis() - lastPushMessage < REPETIER_PUSH_STALE;
+}
+
+// Keeps the event socket open; REST polling covers for it while it is down
+void RepetierClient::handlePush() {
+  if (pushClient.handle()) {
+    processPushMessage(pushClient.getMessage(), pushClient.getMessageLength());
+  }
+  if (pushClient.isConnected()) {
+    if (!pushStarted) {
+      // initial snapshot, after that temperatures come in as events
+      sendPushAction("stateList", "{\"includeHistory\":false}", CALLBACK_STATE_LIST);
+      sendPushAction("listPrinter", "{}", CALLBACK_LIST_PRINTER);
+      pushStarted = true;
+      Serial.println("Repetier push socket open");
+    } else if (millis() - lastPushRequest > REPETIER_PUSH_REFRESH) {
+      // print progress is not evented, refresh it over the open socket
+      sendPushAction("listPrinter", "{}", CALLBACK_LIST_PRINTER);
+    }
+    return;
+  }
+
+  if (!pushClient.isClosed() || myServer[0] == '\0' || myApiKey == "") {
+    return;
+  }
+  if (pushAttempted && millis() - lastPushAttempt < REPETIER_PUSH_RETRY) {
+    return;
+  }
+  if (!breaker.allowRequest()) {
     return;
   }
-  const size_t bufferSize = JSON_OBJECT_SIZE(1) + JSON_OBJECT_SIZE(2) + JSON_OBJECT_SIZE(3) + 2*JSON_OBJECT_SIZE(5) + JSON_OBJECT_SIZE(6) + 710;
-  DynamicJsonBuffer jsonBuffer(bufferSize);
+  pushAttempted = true;
+  lastPushAttempt = millis();
+  if (!reachability.isReachable(myServer, myPort)) {
+    return;
+  }
+  pushStarted = false;
+  pushLive = false; // REST keeps polling until the first snapshot has been read
+  pushExtractor.setKey(printerName.c_str());
+  resetPushScan();
+  const char* headers = "";
+  if (encodedAuth != "") {
+    headers = scratch.format("Authorization: Basic %s\r\n", encodedAuth.c_str());
+  }
+  pushClient.connect(myServer, myPort, scratch.format("/socket?apikey=%s", myApiKey.c_str()), headers);
+}
+
+void RepetierClient::sendPushAction(const char* action, const char* data, int callbackId) {
+  pushClient.send(scratch.format("{\"action\":\"%s\",\"data\":%s,\"printer\":\"\",\"callback_id\":%d}", action, data, callbackId));
+  lastPushRequest = millis();
+}
+
+// Every message was streamed through pushExtractor while it arrived, so list and
+// state replies of any size are read without a document tree. Only a reply that
+// was read completely keeps the socket live; anything else hands back to REST.
+void RepetierClient::processPushMessage(char* message, size_t length) {
+  boolean stateFound = pushStateFound; // finish() reports missing paths too
+  boolean read = pushExtractor.finish();
+  int callbackId = pushCallback;
+  ListEntry selected = pushList.selected;
+  int elements = pushList.elements;
+  resetPushScan();
+
+  if (!read) {
+    if (pushLive) {
+      Serial.println("Repetier push message unreadable, polling over REST");
+    }
+    pushLive = false;
+    return;
+  }
+  if (callbackId == CALLBACK_LIST_PRINTER || callbackId == CALLBACK_STATE_LIST) {
+    if (!pushLive) {
+      Serial.println("Repetier push updates active");
+    }
+    pushLive = true;
+    lastPushMessage = millis();
+    updatedAt = lastPushMessage;
+    printerError.clear();
+    clearFingerprints(); // REST results are older than this
+    if (callbackId == CALLBACK_LIST_PRINTER && elements > 0) {
+      Serial.printf("Size of root: %d\n", elements);
+      applyListEntry(selected);
+    } else if (callbackId == CALLBACK_STATE_LIST && stateFound) {
+      printerData.toolTemp = pushStaged.toolTemp;
+      printerData.toolTargetTemp = pushStaged.toolTargetTemp;
+      printerData.bedTemp = pushStaged.bedTemp;
+      printerData.bedTargetTemp = pushStaged.bedTargetTemp;
+    }
+    return;
+  }
+  if (callbackId != -1 || !pushClient.isMessageBuffered()) {
+    return; // an event list too large to keep, the next listPrinter refresh catches up
+  }
 
-  // Parse JSON object
-  JsonArray& root = jsonBuffer.parseArray(printClient);
-    
+  // event list, parsed in place, the message is not used afterwards
+  PooledJsonBuffer jsonBuffer(length);
+  JsonObject& root = jsonBuffer.parseObject(message);
   if (!root.success()) {
-    printerData.error = "Repetier Data Parsing failed: " + String(myServer) + ":" + String(myPort);
-    Serial.println(printerData.error);
-    printerData.state = "";
+    Serial.println("Repetier push message parsing failed");
     return;
   }
 
+  // event list
+  JsonArray& events = root["data"];
+  for (unsigned int inx = 0; inx < events.size(); inx++) {
+    JsonObject& event = events[inx];
+    const char* name = event["event"] | "";
+    if (strcmp(name, "printerListChanged") == 0) {
+      JsonArray& list = event["data"];
+      if (list.size() > 0) {
+        applyPrinterList(list);
+      }
+      continue;
+    }
+    if (printerName != (const char*)event["printer"]) {
+      continue;
+    }
+    if (strcmp(name, "temp") == 0) {
+      // id is the extruder number, heated beds are numbered from 1000
+      int id = event["data"]["id"];
+      if (id == 0) {
+        printerData.toolTemp = PrinterState::parseTenths(event["data"]["T"]);
+        printerData.toolTargetTemp = PrinterState::parseTenths(event["data"]["S"]);
+      } else if (id == 1000) {
+        printerData.bedTemp = PrinterState::parseTenths(event["data"]["T"]);
+        printerData.bedTargetTemp = PrinterState::parseTenths(event["data"]["S"]);
+      }
+    } else if (strcmp(name, "jobsChanged") == 0 || strcmp(name, "jobStarted") == 0 || strcmp(name, "jobFinished") == 0 || strcmp(name, "jobKilled") == 0) {
+      sendPushAction("listPrinter", "{}", CALLBACK_LIST_PRINTER);
+    }
+  }
+}
+
+boolean RepetierClient::processPrinterList() {
+  if (httpClient.getStatusCode() != 304 && !listExtractor.finish()) {
+    printerError = scratch.format("Repetier Data Parsing failed: %s:%d", myServer, myPort);
+    Serial.println(printerError.c_str());
+    printerData.state = PRINTER_UNKNOWN;
+    httpClient.clearFingerprint(listFingerprint);
+    return false;
+  }
+  if (httpClient.isUnchanged(listFingerprint)) {
+    return true; // 304 or the same body as last time
+  }
+  Serial.printf("Size of root: %d\n", restList.elements);
+  applyListEntry(restList.selected);
+  return true;
+}
+
+// Picks our printer out of the listPrinter answer / printerListChanged event on the socket
+void RepetierClient::applyPrinterList(JsonArray& root) {
   int inx = 0;
   int count = root.size();
-  Serial.println("Size of root: " + String(count));
+  Serial.printf("Size of root: %d\n", count);
   for (int i = 0; i < count; i++) {
-    Serial.println("Printer: " + String((const char*)root[i]["slug"]));
-    if (String((const char*)root[i]["slug"]) == printerData.printerName) {
+    Serial.printf("Printer: %s\n", root[i]["slug"] | "");
+    if (printerName == (const char*)root[i]["slug"]) {
       inx = i;
       break;
     }
   }
   
   JsonObject& pr = root[inx];
-  
+  ListEntry entry;
+  copyValue(entry.slug, sizeof(entry.slug), pr["slug"]);
+  copyValue(entry.job, sizeof(entry.job), pr["job"]);
+  copyValue(entry.totalLines, sizeof(entry.totalLines), pr["totalLines"]);
+  copyValue(entry.online, sizeof(entry.online), pr["online"]);
+  copyValue(entry.done, sizeof(entry.done), pr["done"]);
+  copyValue(entry.linesSend, sizeof(entry.linesSend), pr["linesSend"]);
+  copyValue(entry.printTime, sizeof(entry.printTime), pr["printTime"]);
+  copyValue(entry.printedTimeComp, sizeof(entry.printedTimeComp), pr["printedTimeComp"]);
+  applyListEntry(entry);
+}
+
+void RepetierClient::applyListEntry(const ListEntry &entry) {
   //printerData.averagePrintTime = (const char*)pr[""];
-  printerData.estimatedPrintTime = (const char*)pr["printTime"];
-  printerData.fileName = (const char*) pr["job"];
-  printerData.fileSize = (const char*) pr["totalLines"];
+  printerData.estimatedPrintTime = PrinterState::parseWhole(entry.printTime);
+  printerData.setFileName(entry.job);
+  printerData.fileSize = PrinterState::parseWhole(entry.totalLines);
   //printerData.filamentLength = (const char*) pr[""];
-  printerData.state = (const char*) pr["online"];
+  printerData.state = strcmp(entry.online, "1") == 0 ? PRINTER_OPERATIONAL : PRINTER_OFFLINE;
   //printerData.lastPrintTime = (const char*) pr[""];
-  printerData.progressCompletion = (const char*) pr["done"];
-  printerData.progressFilepos = (const char*) pr["linesSend"];
-  printerData.progressPrintTime = (const char*) pr["printedTimeComp"];
+  printerData.progressCompletion = PrinterState::parseTenths(entry.done, false);
+  printerData.progressFilepos = PrinterState::parseWhole(entry.linesSend);
+  printerData.progressPrintTime = PrinterState::parseWhole(entry.printedTimeComp);
 
 //Figure out Time Left
   long timeTot=0;
   long timeElap=0;
-  long timeLeft=0;
-  if (printerData.estimatedPrintTime != "" ) {
-    timeTot = atol(pr["printTime"]);
+  if (printerData.estimatedPrintTime != PRINTER_VALUE_UNKNOWN) {
+    timeTot = printerData.estimatedPrintTime;
   }
-  if (printerData.progressPrintTime != "") {
-    timeElap= atol(pr["printedTimeComp"]);
+  if (printerData.progressPrintTime != PRINTER_VALUE_UNKNOWN) {
+    timeElap = printerData.progressPrintTime;
   }
-  timeLeft = timeTot-timeElap; 
-  printerData.progressPrintTimeLeft = String(timeLeft);
+  printerData.progressPrintTimeLeft = timeTot-timeElap;
 
-  if (printerData.fileName != "none") {
+  if (strcmp(printerData.fileName, "none") != 0) {
     printerData.isPrinting = true;
   } else {
     printerData.isPrinting = false;
   }
 
   if (printerData.isPrinting) {  
-    Serial.println("Printing: " + printerData.fileName);
+    Serial.printf("Printing: %s\n", printerData.fileName);
   }
   
   if (isOperational()) {
-    Serial.println("Status: " + printerData.state);
+    Serial.printf("Status: %s\n", PrinterState::getStatusName(printerData.state));
   } else {
     Serial.println("Printer Not Operational");
   }
+}
 
-  //**** get the Printer Temps and Stat
-  apiGetData = "GET /printer/api/?a=stateList&apikey=" + myApiKey;
-  printClient = getSubmitRequest(apiGetData);
-  if (printerData.error != "") {
+// The temperatures only reach printerData if the whole body was read and it differs
+// from last time, so a response cut off half way leaves the previous ones intact
+void RepetierClient::processStateList() {
+  if (httpClient.getStatusCode() != 304 && !stateExtractor.finish()) {
+    httpClient.clearFingerprint(stateFingerprint);
+    printerData.isPrinting = false;
+    printerData.toolTemp = PRINTER_TENTHS_UNKNOWN;
+    printerData.toolTargetTemp = PRINTER_TENTHS_UNKNOWN;
+    printerData.bedTemp = PRINTER_TENTHS_UNKNOWN;
+    printerData.bedTargetTemp = PRINTER_TENTHS_UNKNOWN;
     return;
   }
-  const size_t bufferSize2 = 3*JSON_OBJECT_SIZE(2) + 2*JSON_OBJECT_SIZE(3) + JSON_OBJECT_SIZE(9) + 300;
-  DynamicJsonBuffer jsonBuffer2(bufferSize2);
+  if (httpClient.isUnchanged(stateFingerprint)) {
+    return; // 304 or the same body as last time
+  }
+  printerData.toolTemp = staged.toolTemp;
+  printerData.toolTargetTemp = staged.toolTargetTemp;
+  printerData.bedTemp = staged.bedTemp;
+  printerData.bedTargetTemp = staged.bedTargetTemp;
 
-  //Parse JSON object
-  JsonObject& root2 = jsonBuffer2.parseObject(printClient);
+  if (printerData.isPrinting) {
+    Serial.printf("Status: %s %s(%d%%)\n", PrinterState::getStatusName(printerData.state), printerData.fileName, printerData.getCompletionPercent());
+  }
+}
 
-  //Select printer
-  JsonObject& pr2 = root2[printerData.printerName];
+void RepetierClient::onValue(void* context, uint8_t field, const char* value) {
+  RepetierClient* client = (RepetierClient*)context;
+  client->setField(client->restList, client->staged, field, value);
+}
 
-  if (!root2.success()) {
-    printerData.isPrinting = false;
-    printerData.toolTemp = "";
-    printerData.toolTargetTemp = "";
-    printerData.bedTemp = "";
-    printerData.bedTargetTemp = "";
+void RepetierClient::onPushValue(void* context, uint8_t field, const char* value) {
+  RepetierClient* client = (RepetierClient*)context;
+  if (field == PUSH_CALLBACK) {
+    client->pushCallback = atoi(value);
     return;
   }
+  if (field >= STATE_TOOL_TEMP) {
+    client->pushStateFound = true;
+  }
+  client->setField(client->pushList, client->pushStaged, field, value);
+}
 
-  printerData.toolTemp = (const char*) pr2["extruder"][0]["tempRead"];
-  printerData.toolTargetTemp = (const char*) pr2["extruder"][0]["tempSet"];
-  printerData.bedTemp = (const char*) pr2["heatedBeds"][0]["tempRead"];
-  printerData.bedTargetTemp = (const char*) pr2["heatedBeds"][0]["tempSet"];
+// Forgets the socket message read so far
+void RepetierClient::resetPushScan() {
+  memset(&pushList, 0, sizeof(pushList));
+  pushStaged.reset();
+  pushCallback = 0;
+  pushStateFound = false;
+}
 
-  if (printerData.isPrinting) {
-    Serial.println("Status: " + printerData.state + " " + printerData.fileName + "(" + printerData.progressCompletion + "%)");
+// Stores one value of a listPrinter or stateList response
+void RepetierClient::setField(ListScan &scan, PrinterState &target, uint8_t field, const char* value) {
+  ListEntry &entry = scan.entry;
+  switch (field) {
+    case LIST_SLUG: copyValue(entry.slug, sizeof(entry.slug), value); break;
+    case LIST_JOB: copyValue(entry.job, sizeof(entry.job), value); break;
+    case LIST_TOTAL_LINES: copyValue(entry.totalLines, sizeof(entry.totalLines), value); break;
+    case LIST_ONLINE: copyValue(entry.online, sizeof(entry.online), value); break;
+    case LIST_DONE: copyValue(entry.done, sizeof(entry.done), value); break;
+    case LIST_LINES_SEND: copyValue(entry.linesSend, sizeof(entry.linesSend), value); break;
+    case LIST_PRINT_TIME: copyValue(entry.printTime, sizeof(entry.printTime), value); break;
+    case LIST_PRINTED_TIME: copyValue(entry.printedTimeComp, sizeof(entry.printedTimeComp), value); break;
+    case LIST_ELEMENT:
+      // the slug comes late in each printer, so the element is only kept once it is complete;
+      // the first printer stands in until the configured one shows up
+      if (entry.slug[0] != '\0') {
+        Serial.printf("Printer: %s\n", entry.slug);
+      }
+      if (!scan.matched) {
+        scan.matched = printerName == entry.slug;
+        if (scan.matched || scan.elements == 0) {
+          scan.selected = entry;
+        }
+      }
+      scan.elements++;
+      memset(&entry, 0, sizeof(entry));
+      break;
+    case STATE_TOOL_TEMP: target.toolTemp = PrinterState::parseTenths(value); break;
+    case STATE_TOOL_TARGET: target.toolTargetTemp = PrinterState::parseTenths(value); break;
+    case STATE_BED_TEMP: target.bedTemp = PrinterState::parseTenths(value); break;
+    case STATE_BED_TARGET: target.bedTargetTemp = PrinterState::parseTenths(value); break;
+    default: break;
+  }
+}
+
+void RepetierClient::copyValue(char* dest, size_t size, const char* value) {
+  if (value == NULL) {
+    value = "";
   }
+  strncpy(dest, value, size - 1);
+  dest[size - 1] = '\0';
 }
 
 void RepetierClient::getPrinterPsuState() {
@@ -232,32 +557,17 @@ void RepetierClient::getPrinterPsuState() {
 
 // Reset all PrinterData
 void RepetierClient::resetPrintData() {
-  printerData.averagePrintTime = "";
-  printerData.estimatedPrintTime = "";
-  printerData.fileName = "";
-  printerData.fileSize = "";
-  printerData.lastPrintTime = "";
-  printerData.progressCompletion = "";
-  printerData.progressFilepos = "";
-  printerData.progressPrintTime = "";
-  printerData.progressPrintTimeLeft = "";
-  printerData.state = "";
-  printerData.toolTemp = "";
-  printerData.toolTargetTemp = "";
-  printerData.filamentLength = "";
-  printerData.bedTemp = "";
-  printerData.bedTargetTemp = "";
-  printerData.isPrinting = false;
-  printerData.isPSUoff = false;
-  printerData.error = "";
+  printerData.reset();
+  printerError.clear();
+  updatedAt = 0;
 }
 
 String RepetierClient::getAveragePrintTime(){
-  return printerData.averagePrintTime;
+  return PrinterState::formatWhole(printerData.averagePrintTime);
 }
 
 String RepetierClient::getEstimatedPrintTime() {
-  return printerData.estimatedPrintTime;
+  return PrinterState::formatWhole(printerData.estimatedPrintTime);
 }
 
 String RepetierClient::getFileName() {
@@ -265,36 +575,35 @@ String RepetierClient::getFileName() {
 }
 
 String RepetierClient::getFileSize() {
-  return printerData.fileSize;
+  return PrinterState::formatWhole(printerData.fileSize);
 }
 
 String RepetierClient::getLastPrintTime(){
-  return printerData.lastPrintTime;
+  return PrinterState::formatWhole(printerData.lastPrintTime);
 }
 
 String RepetierClient::getProgressCompletion() {
-  return String(printerData.progressCompletion.toInt());
+  return String(printerData.getCompletionPercent());
 }
 
 String RepetierClient::getProgressFilepos() {
-  return printerData.progressFilepos;  
+  return PrinterState::formatWhole(printerData.progressFilepos);
 }
 
 String RepetierClient::getProgressPrintTime() {
-  return printerData.progressPrintTime;
+  return PrinterState::formatWhole(printerData.progressPrintTime);
 }
 
 String RepetierClient::getProgressPrintTimeLeft() {
-  String rtnValue = printerData.progressPrintTimeLeft;
-  if (getProgressCompletion() == "100") {
-    rtnValue = "0"; // Print is done so this should be 0 this is a fix for OctoPrint
+  if (printerData.progressPrintTimeLeft == PRINTER_VALUE_UNKNOWN) {
+    return "";
   }
-  return rtnValue;
+  return String(printerData.getPrintTimeLeft());
 }
 
 String RepetierClient::getState() {
   String rtnValue = "Offline";
-  if (printerData.state == "1") {
+  if (printerData.state == PRINTER_OPERATIONAL) {
     rtnValue = "Operational";
   }
   return rtnValue;
@@ -310,38 +619,46 @@ boolean RepetierClient::isPSUoff() {
 
 boolean RepetierClient::isOperational() {
   boolean operational = false;
-  if (printerData.state == "1" || isPrinting()) {
+  if (printerData.state == PRINTER_OPERATIONAL || isPrinting()) {
     operational = true;
   }
   return operational;
 }
 
 String RepetierClient::getTempBedActual() {
-  String temp = printerData.bedTemp;
-  temp.remove(temp.indexOf(".") + 3);
-  return temp;
+  return PrinterState::formatTenths(printerData.bedTemp);
 }
 
 String RepetierClient::getTempBedTarget() {
-  return printerData.bedTargetTemp;
+  return PrinterState::formatTenths(printerData.bedTargetTemp);
 }
 
 String RepetierClient::getTempToolActual() {
-  String temp = printerData.toolTemp;
-  temp.remove(temp.indexOf(".") + 3);
-  return temp;
+  return PrinterState::formatTenths(printerData.toolTemp);
 }
 
 String RepetierClient::getTempToolTarget() {
-  return printerData.toolTargetTemp;
+  return PrinterState::formatTenths(printerData.toolTargetTemp);
 }
 
 String RepetierClient::getFilamentLength() {
-  return printerData.filamentLength;
+  return PrinterState::formatWhole(printerData.filamentLength);
+}
+
+const PrinterState &RepetierClient::getPrinterState() {
+  return printerData;
 }
 
 String RepetierClient::getError() {
-  return printerData.error;
+  return printerError.c_str();
+}
+
+// seconds since printerData was last confirmed by the server, -1 if it holds nothing
+long RepetierClient::getDataAge() {
+  if (updatedAt == 0) {
+    return -1;
+  }
+  return (millis() - updatedAt) / 1000;
 }
 
 String RepetierClient::getValueRounded(String value) {
@@ -359,9 +676,13 @@ int RepetierClient::getPrinterPort() {
 }
 
 String RepetierClient::getPrinterName() {
-  return printerData.printerName;
+  return printerName.c_str();
 }
 
 void RepetierClient::setPrinterName(String printer) {
-  printerData.printerName = printer;
+  if (printerName != printer.c_str()) {
+    resetPrintData(); // belongs to the previous printer
+  }
+  printerName = printer;
+  pushExtractor.setKey(printerName.c_str());
 }
@@ -27,55 +27,131 @@ SOFTWARE.
 #pragma once
 #include <ESP8266WiFi.h>
 #include "libs/ArduinoJson/ArduinoJson.h"
+#include "JsonBufferPool.h"
 #include <base64.h>
+#include "AsyncHttpClient.h"
+#include "JsonStreamExtractor.h"
+#include "WebSocketClient.h"
+#include "CircuitBreaker.h"
+#include "ReachabilityProbe.h"
+#include "PrinterState.h"
+#include "ScratchArena.h"
+#include "FixedString.h"
+
+#define REPETIER_PUSH_RETRY 60000     // ms between attempts to open the event socket
+#define REPETIER_PUSH_REFRESH 15000   // ms between printer list refreshes over the socket
+#define REPETIER_PUSH_STALE 30000     // ms without a readable list or state reply before REST polling takes over
 
 class RepetierClient {
 
 private:
-  char myServer[100];
+  char myServer[100] = "";
   int myPort = 3344;
-  String myApiKey = "";
-  String encodedAuth = "";
+  FixedString<60> myApiKey;
+  FixedString<132> encodedAuth; // base64 of user:pass, with its line breaks
+  char headerBlock[HTTP_HEADER_BLOCK_SIZE] = "";
   boolean pollPsu;
   const String printerType = "Repetier";
 
   void resetPrintData();
   boolean validate();
-  WiFiClient getSubmitRequest(String apiGetData);
-  WiFiClient getPostRequest(String apiPostData, String apiPostBody);
- 
-  String result;
+  boolean getSubmitRequest(const char* apiGetData, const ResponseFingerprint &fingerprint, JsonStreamExtractor &extractor);
+  boolean checkResponse();
+  void clearFingerprints();
+  void markStale(const char* error);
+  void renderHeaders();
+  boolean processPrinterList();
+  void processStateList();
+  void applyPrinterList(JsonArray& root);
+  static void onValue(void* context, uint8_t field, const char* value);
+  static void onPushValue(void* context, uint8_t field, const char* value);
+  static void copyValue(char* dest, size_t size, const char* value);
+  void handlePush();
+  void sendPushAction(const char* action, const char* data, int callbackId);
+  void processPushMessage(char* message, size_t length);
+
+  enum PollStep { STEP_IDLE, STEP_LIST, STEP_STATE };
+  enum ResponseField {
+    LIST_SLUG,
+    LIST_JOB,
+    LIST_TOTAL_LINES,
+    LIST_ONLINE,
+    LIST_DONE,
+    LIST_LINES_SEND,
+    LIST_PRINT_TIME,
+    LIST_PRINTED_TIME,
+    LIST_ELEMENT,
+    STATE_TOOL_TEMP,
+    STATE_TOOL_TARGET,
+    STATE_BED_TEMP,
+    STATE_BED_TARGET,
+    PUSH_CALLBACK
+  };
+  static const JsonPath LIST_PATHS[];
+  static const JsonPath STATE_PATHS[];
+  static const JsonPath PUSH_PATHS[];
 
+  // One printer of listPrinter, held until its slug shows whether it is ours
+  typedef struct {
+    char slug[JSON_STREAM_KEY_SIZE];
+    char job[JSON_STREAM_VALUE_SIZE];
+    char totalLines[24];
+    char online[8];
+    char done[24];
+    char linesSend[24];
+    char printTime[24];
+    char printedTimeComp[24];
+  } ListEntry;
+  // A listPrinter answer being read
   typedef struct {
-    String averagePrintTime;
-    String estimatedPrintTime;
-    String fileName;
-    String fileSize;
-    String lastPrintTime;
-    String progressCompletion;
-    String progressFilepos;
-    String progressPrintTime;
-    String progressPrintTimeLeft;
-    String state;
-    String toolTemp;
-    String toolTargetTemp;
-    String filamentLength;
-    String bedTemp;
-    String bedTargetTemp;
-    boolean isPrinting;
-    boolean isPSUoff;
-    String error;
-    String printerName;
-  } PrinterStruct;
-
-  PrinterStruct printerData;
+    ListEntry entry;     // printer being read
+    ListEntry selected;  // ours, or the first one until ours shows up
+    int elements;
+    boolean matched;
+  } ListScan;
+  AsyncHttpClient httpClient;
+  CircuitBreaker breaker;
+  PollStep pollStep = STEP_IDLE;
+  ResponseFingerprint listFingerprint;
+  ResponseFingerprint stateFingerprint;
+  JsonStreamExtractor listExtractor;
+  JsonStreamExtractor stateExtractor;
+  ListScan restList;
+
+  enum { CALLBACK_LIST_PRINTER = 1, CALLBACK_STATE_LIST = 2 };
+  WebSocketClient pushClient;
+  boolean pushStarted = false;
+  boolean pushAttempted = false;
+  unsigned long lastPushAttempt = 0;
+  unsigned long lastPushRequest = 0;
+  unsigned long lastPushMessage = 0;
+  boolean pushLive = false;        // a list or state reply was read since the socket opened
+  JsonStreamExtractor pushExtractor;
+  ListScan pushList;
+  PrinterState pushStaged;
+  int pushCallback = 0;
+  boolean pushStateFound = false;
+
+  PrinterState printerData;
+  unsigned long updatedAt = 0; // millis() of the last good response, 0 after a reset
+  PrinterState staged; // temperatures of the stateList being read, copied to printerData once it checks out
+  FixedString<96> printerError;
+  FixedString<40> printerName;
+
+  void applyListEntry(const ListEntry &entry);
+  void setField(ListScan &scan, PrinterState &target, uint8_t field, const char* value);
+  void resetPushScan();
 
   
 public:
-  RepetierClient(String ApiKey, String server, int port, String user, String pass, boolean psu);
+  RepetierClient(const char* ApiKey, const char* server, int port, const char* user, const char* pass, boolean psu);
   void getPrinterJobResults();
   void getPrinterPsuState();
-  void updatePrintClient(String ApiKey, String server, int port, String user, String pass, boolean psu);
+  void handle();
+  boolean isBusy();
+  boolean isPushActive();
+  CircuitBreaker &getCircuitBreaker();
+  void updatePrintClient(const char* ApiKey, const char* server, int port, const char* user, const char* pass, boolean psu);
 
   String getAveragePrintTime();
   String getEstimatedPrintTime();
@@ -96,7 +172,9 @@ public:
   String getTempToolTarget();
   String getFilamentLength();
   String getValueRounded(String value);
+  const PrinterState &getPrinterState();
   String getError();
+  long getDataAge();
   String getPrinterType();
   int getPrinterPort();
   String getPrinterName();
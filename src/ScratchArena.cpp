@@ -0,0 +1,93 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "ScratchArena.h"
+
+ScratchArena scratch;
+
+// printf into the arena; text that does not fit is cut (and counted)
+const char* ScratchArena::format(const char* pattern, ...) {
+  if (used >= SCRATCH_ARENA_SIZE) {
+    overflows++;
+    return "";
+  }
+  char* start = buffer + used;
+  size_t available = SCRATCH_ARENA_SIZE - used;
+  va_list args;
+  va_start(args, pattern);
+  int length = vsnprintf(start, available, pattern, args);
+  va_end(args);
+  if (length < 0) {
+    start[0] = '\0';
+    length = 0;
+  }
+  if ((size_t)length >= available) {
+    overflows++;
+    length = available - 1;
+  }
+  used += length + 1;
+  if (used > peak) {
+    peak = used;
+  }
+  return start;
+}
+
+const char* ScratchArena::copy(const char* text) {
+  return format("%s", text);
+}
+
+size_t ScratchArena::mark() {
+  return used;
+}
+
+void ScratchArena::rewind(size_t mark) {
+  if (mark < used) {
+    used = mark;
+  }
+  if (used == 0 && peak > reportedPeak) {
+    // reported once a scope has ended, so the arena can be sized from real use
+    reportedPeak = peak;
+    Serial.printf("Scratch arena peak: %u of %u bytes, %lu cut\n", (unsigned)peak, (unsigned)SCRATCH_ARENA_SIZE, overflows);
+  }
+}
+
+size_t ScratchArena::getUsed() {
+  return used;
+}
+
+size_t ScratchArena::getPeak() {
+  return peak;
+}
+
+unsigned long ScratchArena::getOverflows() {
+  return overflows;
+}
+
+ScratchScope::ScratchScope() {
+  start = scratch.mark();
+}
+
+ScratchScope::~ScratchScope() {
+  scratch.rewind(start);
+}
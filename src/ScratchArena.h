@@ -0,0 +1,65 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <Arduino.h>
+
+#define SCRATCH_ARENA_SIZE 1024   // bytes of transient text one poll or page render may hold at once
+
+// Bump allocator for text that only lives until the end of a poll or page
+// render: request lines, error messages, formatted values. Everything taken
+// after a mark is given back at once by rewinding to it, so none of it goes
+// through the heap. Values that must survive are copied out (e.g. into a String).
+class ScratchArena {
+
+private:
+  char buffer[SCRATCH_ARENA_SIZE];
+  size_t used = 0;
+  size_t peak = 0;
+  size_t reportedPeak = 0;
+  unsigned long overflows = 0;
+
+public:
+  const char* format(const char* pattern, ...) __attribute__ ((format (printf, 2, 3)));
+  const char* copy(const char* text);
+  size_t mark();
+  void rewind(size_t mark);
+
+  size_t getUsed();
+  size_t getPeak();
+  unsigned long getOverflows();
+};
+
+extern ScratchArena scratch;
+
+// Rewinds the scratch arena to where it was when the scope was entered
+class ScratchScope {
+
+private:
+  size_t start;
+
+public:
+  ScratchScope();
+  ~ScratchScope();
+};
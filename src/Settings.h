@@ -44,10 +44,15 @@ SOFTWARE.
 #include <ESP8266mDNS.h>
 #include <ArduinoOTA.h>
 #include <ESP8266HTTPUpdateServer.h>
+#include "FixedString.h"
+#include "PageWriter.h"
+#include "AllocationCounter.h"
 #include "TimeClient.h"
 #include "RepetierClient.h"
 #include "OctoPrintClient.h"
 #include "OpenWeatherMapClient.h"
+#include "PollScheduler.h"
+#include "CoopScheduler.h"
 #include "WeatherStationFonts.h"
 #include "FS.h"
 #include "SH1106Wire.h"
@@ -63,32 +68,38 @@ SOFTWARE.
 // OctoPrint / Repetier Monitoring -- Monitor your 3D OctoPrint or Repetier Server
 //#define USE_REPETIER_CLIENT       // Uncomment this line to use the Repetier Printer Server -- OctoPrint is used by default and is most common
 #if defined(PRINTER_MON)
-String PrinterApiKey = "";   // ApiKey from your User Account on OctoPrint / Repetier
-String PrinterHostName = "octopi";// Default 'octopi' -- or hostname if different (optional if your IP changes)
-String PrinterServer = "";   // IP or Address of your OctoPrint / Repetier Server (DO NOT include http://)
+FixedString<60> PrinterApiKey = "";   // ApiKey from your User Account on OctoPrint / Repetier
+FixedString<60> PrinterHostName = "octopi";// Default 'octopi' -- or hostname if different (optional if your IP changes)
+FixedString<60> PrinterServer = "";   // IP or Address of your OctoPrint / Repetier Server (DO NOT include http://)
 int PrinterPort = 80;        // the port you are running your OctoPrint / Repetier server on (usually 80);
-String PrinterAuthUser = "";      // only used if you have haproxy or basic athentintication turned on (not default)
-String PrinterAuthPass = "";      // only used with haproxy or basic auth (only needed if you must authenticate)
+FixedString<30> PrinterAuthUser = "";      // only used if you have haproxy or basic athentintication turned on (not default)
+FixedString<60> PrinterAuthPass = "";      // only used with haproxy or basic auth (only needed if you must authenticate)
+// Seconds between printer polls, picked by what the printer is doing
+int PollHeatingSeconds = 5;       // heating toward the target temperature
+int PollPrintingSeconds = 60;     // the long middle of a print
+int PollFinishingSeconds = 10;    // the last few percent of a print
+int PollIdleSeconds = 60;         // operational, not printing
+int PollOfflineSeconds = 300;     // printer offline or PSU off
 #endif
 
 // Weather Configuration
 boolean DISPLAYWEATHER = false; // true = show weather when not printing / false = no weather
-String WeatherApiKey = ""; // Your API Key from http://openweathermap.org/
+FixedString<60> WeatherApiKey = ""; // Your API Key from http://openweathermap.org/
 // Default City Location (use http://openweathermap.org/find to find city ID)
 int CityIDs[] = { 593116 }; //Only USE ONE for weather marquee
 boolean IS_METRIC = true; // false = Imperial and true = Metric
 // Languages: ar, bg, ca, cz, de, el, en, fa, fi, fr, gl, hr, hu, it, ja, kr, la, lt, mk, nl, pl, pt, ro, ru, se, sk, sl, es, tr, ua, vi, zh_cn, zh_tw
-String WeatherLanguage = "en";  //Default (en) English
+FixedString<8> WeatherLanguage = "en";  //Default (en) English
 
 // MQTT
 boolean MqttUse = false;
-String MqttServer = "";
+FixedString<39> MqttServer = "";
 int MqttPort = 1883;
-String MqttUser = "admin";
-String MqttPsw = "admin";
-String MqttTempTopic = "";
-String MqttHumdTopic = "";
-String MqttLwtTopic = "";
+FixedString<16> MqttUser = "admin";
+FixedString<16> MqttPsw = "admin";
+FixedString<128> MqttTempTopic = "";
+FixedString<128> MqttHumdTopic = "";
+FixedString<128> MqttLwtTopic = "";
 
 // Webserver
 const int WEBSERVER_PORT = 80; // The port you can access this device on over HTTP
@@ -99,7 +110,9 @@ char* www_password = "password";  // Password for the Web Interface
 
 // Date and Time
 float UtcOffset = +3; // Hour offset from GMT for your timezone
+//#define DST_BENCHMARK       // Uncomment to print the cost of the local time lookup at boot (debugging only)
 boolean DstUsed = true;
+FixedString<120> NtpServers = "pool.ntp.org,time.google.com,time.nist.gov"; // SNTP servers, tried in order
 boolean IS_24HOUR = true;     // 23:00 millitary 24 hour clock
 int minutesBetweenDataRefresh = 15;
 boolean DISPLAYCLOCK = true;   // true = Show Clock when not printing / false = turn off display when not printing
@@ -124,10 +137,10 @@ boolean HAS_PSU = false; // Set to true if https://github.com/kantlivelong/OctoP
 
 // OTA Updates
 boolean ENABLE_OTA = true;     // this will allow you to load firmware to the device over WiFi (see OTA for ESP8266)
-String OTA_Password = "";      // Set an OTA password here -- leave blank if you don't want to be prompted for password
+FixedString<32> OTA_Password = "";      // Set an OTA password here -- leave blank if you don't want to be prompted for password
 
 //******************************
 // End Settings
 //******************************
 
-String themeColor = "light-green"; // this can be changed later in the web interface.
+FixedString<20> themeColor = "light-green"; // this can be changed later in the web interface.
@@ -32,205 +32,378 @@ TimeClient::TimeClient(float utcOffset) {
   myUtcOffset = utcOffset;
 }
 
+// comma separated host names, tried in order until one answers
+void TimeClient::setServers(const char* servers) {
+  FixedString<NTP_SERVER_LIST_SIZE> list = servers;
+  list.trim();
+  if (list.isEmpty()) {
+    list = NTP_DEFAULT_SERVERS;
+  }
+  if (list != serverList) {
+    syncRequested = true;
+  }
+  serverList = list;
+}
+
+// copies entry index of the server list into currentServer; false past the end
+boolean TimeClient::selectServer(int index) {
+  int start = 0;
+  for (int inx = 0; inx < index; inx++) {
+    start = serverList.indexOf(',', start);
+    if (start < 0) {
+      return false;
+    }
+    start++;
+  }
+  int end = serverList.indexOf(',', start);
+  if (end < 0) {
+    end = serverList.length();
+  }
+  FixedString<sizeof(currentServer) - 1> server;
+  server.assign(serverList.c_str() + start, end - start);
+  server.trim();
+  if (server.isEmpty()) {
+    return false;
+  }
+  strcpy(currentServer, server.c_str());
+  return true;
+}
+
 void TimeClient::updateTime() {
-  WiFiClient client;
-  
-  if (!client.connect(ntpServerName, httpPort)) {
-    Serial.println("connection failed");
+  if (state != SNTP_IDLE) {
+    return;
+  }
+  serverIndex = 0;
+  lastSyncAttempt = millis();
+  syncRequested = false;
+  startServer();
+}
+
+void TimeClient::startServer() {
+  if (!selectServer(serverIndex)) {
+    Serial.println("SNTP: no time server answered");
+    state = SNTP_IDLE;
+    lastSyncFailed = true;
     return;
   }
+  state = SNTP_RESOLVING;
+  stateStarted = millis();
+}
+
+boolean TimeClient::isBusy() {
+  return state != SNTP_IDLE;
+}
+
+boolean TimeClient::isSyncDue() {
+  if (state != SNTP_IDLE) {
+    return false;
+  }
+  if (syncRequested) {
+    return true;
+  }
+  if (localEpoc == 0 || lastSyncFailed) {
+    return millis() - lastSyncAttempt >= NTP_SYNC_RETRY;
+  }
+  return millis() - lastSyncAttempt >= syncInterval;
+}
+
+void TimeClient::sendRequest() {
+  if (!udpStarted) {
+    udpStarted = udp.begin(NTP_LOCAL_PORT);
+  }
+  while (udp.parsePacket() > 0) {
+    // drop late answers to an earlier request
+  }
+  memset(packetBuffer, 0, NTP_PACKET_SIZE);
+  packetBuffer[0] = 0b11100011;   // LI unknown, version 4, client mode
+  for (int inx = 0; inx < 8; inx++) {
+    requestCookie[inx] = random(256);
+    packetBuffer[40 + inx] = requestCookie[inx];
+  }
+  udp.beginPacket(serverAddress, NTP_PORT);
+  udp.write(packetBuffer, NTP_PACKET_SIZE);
+  udp.endPacket();
+  sentMicros = micros();
+  state = SNTP_WAITING;
+  stateStarted = millis();
+}
 
-  // This will send the request to the server
-  client.print(String("GET / HTTP/1.1\r\n") +
-               String("Host: www.google.com\r\n") +
-               String("Connection: close\r\n\r\n"));
-  int repeatCounter = 0;
-  while(!client.available() && repeatCounter < 10) {
-    delay(1000);
-    Serial.println(".");
-    repeatCounter++;
-  }
-
-  String line;
-
-  int size = 0;
-  client.setNoDelay(false);
-  while(client.connected()) {
-    while((size = client.available()) > 0) {
-      line = client.readStringUntil('\n');
-      line.toUpperCase();
-      // example:
-      // date: Thu, 19 Nov 2015 20:25:40 GMT
-      if (line.startsWith("DATE: ")) {
-        Serial.println(line);
-        Serial.println(line.substring(23, 25) + ":" + line.substring(26, 28) + ":" +line.substring(29, 31));
-        int parsedHours = line.substring(23, 25).toInt();
-        int parsedMinutes = line.substring(26, 28).toInt();
-        int parsedSeconds = line.substring(29, 31).toInt();
-        Serial.println(String(parsedHours) + ":" + String(parsedMinutes) + ":" + String(parsedSeconds));
-
-        int parsedDay = line.substring(11, 13).toInt();
-        String parsedMonthStr = line.substring(14, 17);
-        int parsedMonth = 1;
-        if (parsedMonthStr == "JAN") {
-          parsedMonth = 1;
-        } else if (parsedMonthStr == "FEB") {
-          parsedMonth = 2;
-        } else if (parsedMonthStr == "MAR") {
-          parsedMonth = 3;
-        } else if (parsedMonthStr == "APR") {
-          parsedMonth = 4;
-        } else if (parsedMonthStr == "MAY") {
-          parsedMonth = 5;
-        } else if (parsedMonthStr == "JUN") {
-          parsedMonth = 6;
-        } else if (parsedMonthStr == "JUL") {
-          parsedMonth = 7;
-        } else if (parsedMonthStr == "AUG") {
-          parsedMonth = 8;
-        } else if (parsedMonthStr == "SEP") {
-          parsedMonth = 9;
-        } else if (parsedMonthStr == "OCT") {
-          parsedMonth = 10;
-        } else if (parsedMonthStr == "NOV") {
-          parsedMonth = 11;
-        } else if (parsedMonthStr == "DEC") {
-          parsedMonth = 12;
-        }
-        int parsedYear = line.substring(18, 22).toInt();
-
-        Serial.println(String(parsedYear) + "-" + String(parsedMonth) + "-" + String(parsedDay));
-
-        localEpoc = (parsedHours * 60 * 60 + parsedMinutes * 60 + parsedSeconds);
-        Serial.println(localEpoc);
-
-        tmElements_t tm;
-        tm.Month = parsedMonth;
-        tm.Day = parsedDay;
-        tm.Year = CalendarYrToTm(parsedYear);
-        tm.Hour = parsedHours;
-        tm.Minute = parsedMinutes;
-        tm.Second = parsedSeconds;
-
-        unixEpoc = makeTime(tm);
-        Serial.println(unixEpoc);
-        
-        localMillisAtUpdate = millis();
-        client.stop();
-      }
+uint32_t TimeClient::readWord(int offset) {
+  return (uint32_t)packetBuffer[offset] << 24 | (uint32_t)packetBuffer[offset + 1] << 16
+    | (uint32_t)packetBuffer[offset + 2] << 8 | (uint32_t)packetBuffer[offset + 3];
+}
+
+// Returns true when a time sync has just completed
+boolean TimeClient::handle() {
+  if (state == SNTP_IDLE && localEpoc != 0 && millis() - localMillisAtUpdate > NTP_REBASE_INTERVAL) {
+    // move the anchor forward so the millis() difference never gets near the wrap
+    unsigned long at = millis();
+    uint64_t now = getCurrentMillis(at);
+    localEpoc = now / 1000;
+    localMillisAtUpdate = at - (unsigned long)(now % 1000);
+  }
+  if (state == SNTP_RESOLVING) {
+    DnsResult result = dnsCache.resolve(currentServer, serverAddress);
+    if (result == DNS_RESOLVED) {
+      sendRequest();
+    } else if (result == DNS_FAILED || millis() - stateStarted > NTP_TIMEOUT) {
+      Serial.printf("SNTP: could not resolve %s\n", currentServer);
+      serverIndex++;
+      startServer();
     }
+    return false;
+  }
+  if (state != SNTP_WAITING) {
+    return false;
+  }
+  if (udp.parsePacket() >= NTP_PACKET_SIZE && readResponse()) {
+    state = SNTP_IDLE;
+    return true;
+  }
+  if (millis() - stateStarted > NTP_TIMEOUT) {
+    Serial.printf("SNTP: no answer from %s\n", currentServer);
+    serverIndex++;
+    startServer();
+  }
+  return false;
+}
+
+boolean TimeClient::readResponse() {
+  unsigned long roundTripMicros = micros() - sentMicros;
+  unsigned long receivedMillis = millis();
+  if (udp.remoteIP() != serverAddress || udp.read(packetBuffer, NTP_PACKET_SIZE) < NTP_PACKET_SIZE) {
+    return false;
   }
+  if (memcmp(packetBuffer + 24, requestCookie, 8) != 0 || (packetBuffer[0] & 0x07) != 4 || packetBuffer[1] == 0) {
+    return false; // not the answer to our request, or a kiss-o'-death
+  }
+
+  // server receive (T2) and transmit (T3) timestamps in unix milliseconds
+  uint64_t serverReceive = (uint64_t)(uint32_t)(readWord(32) - NTP_UNIX_OFFSET) * 1000 + (((uint64_t)readWord(36) * 1000) >> 32);
+  uint64_t serverTransmit = (uint64_t)(uint32_t)(readWord(40) - NTP_UNIX_OFFSET) * 1000 + (((uint64_t)readWord(44) * 1000) >> 32);
+  long roundTrip = (long)(roundTripMicros / 1000) - (long)(serverTransmit - serverReceive);
+  if (roundTrip < 0) {
+    roundTrip = 0;
+  }
+  uint64_t now = serverTransmit + roundTrip / 2;
+
+  boolean wasSynced = localEpoc != 0;
+  long before = getCurrentEpoch();
+  if (wasSynced) {
+    lastCorrection = (long)((int64_t)now - (int64_t)getCurrentMillis(receivedMillis));
+  }
+  updateDrift(now, receivedMillis);
+  lastRoundTrip = roundTrip;
+  localEpoc = now / 1000;
+  localMillisAtUpdate = receivedMillis - (unsigned long)(now % 1000);
+  lastStep = localEpoc - before;
+  snapshotStale = true;
+  lastSyncFailed = false;
+  if (wasSynced) {
+    updateSyncInterval();
+  }
+  Serial.printf("SNTP time from %s: %ld round trip %ld ms, corrected by %ld ms, drift %.2f ppm, next sync in %lu min\n",
+    currentServer, localEpoc, roundTrip, lastCorrection, driftPpm, syncInterval / 60000);
+  return true;
+}
 
+// Crystal error in ppm from the server time and millis() elapsed since an earlier sync
+void TimeClient::updateDrift(uint64_t now, unsigned long receivedMillis) {
+  if (driftEpochMillis == 0) {
+    driftEpochMillis = now;
+    driftMillis = receivedMillis;
+    return;
+  }
+  unsigned long localSpan = receivedMillis - driftMillis;
+  if (localSpan < NTP_DRIFT_MIN_SPAN) {
+    return; // too short to tell drift from network jitter, keep the older reference
+  }
+  int64_t error = (int64_t)(now - driftEpochMillis) - (int64_t)localSpan;
+  float measured = (float)error * 1000000.0 / localSpan;
+  driftEpochMillis = now;
+  driftMillis = receivedMillis;
+  if (measured > NTP_DRIFT_LIMIT || measured < -NTP_DRIFT_LIMIT) {
+    Serial.printf("SNTP: ignoring drift of %.2f ppm\n", measured);
+    return;
+  }
+  driftPpm = driftKnown ? (driftPpm + measured) / 2 : measured;
+  driftKnown = true;
+}
+
+// Sync less often while the clock holds, more often again when it does not
+void TimeClient::updateSyncInterval() {
+  long error = abs(lastCorrection);
+  if (error > NTP_TARGET_ERROR) {
+    syncInterval = max(syncInterval / 2, (unsigned long)NTP_SYNC_MIN);
+  } else if (driftKnown && error < NTP_TARGET_ERROR / 2) {
+    syncInterval = min(syncInterval * 2, (unsigned long)NTP_SYNC_MAX);
+  }
+}
+
+// Server time in unix milliseconds at millis() == at, corrected for drift
+uint64_t TimeClient::getCurrentMillis(unsigned long at) {
+  unsigned long elapsed = at - localMillisAtUpdate;
+  long correction = (long)((float)elapsed * driftPpm / 1000000.0);
+  return (uint64_t)localEpoc * 1000 + elapsed + correction;
 }
 
 void TimeClient::setUtcOffset(float utcOffset) {
 	myUtcOffset = utcOffset;
+	snapshotStale = true;
 }
 
-String TimeClient::getHours() {
-    if (localEpoc == 0) {
-      return "--";
-    }
-    int hours = ((getCurrentEpochWithUtcOffset()  % 86400L) / 3600) % 24;
-    if (hours < 10) {
-      return "0" + String(hours);
-    }
-    return String(hours); // print the hour (86400 equals secs per day)
+// Breaks the local time down once and formats the display strings, done once per second
+void TimeClient::refreshSnapshot() {
+  unsigned long at = millis();
+  uint64_t now = getCurrentMillis(at);
+  nextSnapshotMillis = at + (1000 - (unsigned long)(now % 1000));
+  snapshotStale = false;
+
+  snapshot.valid = localEpoc != 0;
+  if (!snapshot.valid) {
+    strcpy(snapshot.time, "--:--:--");
+    strcpy(snapshot.amPmTime, "--:--:--");
+    strcpy(snapshot.shortTime, "--:--");
+    strcpy(snapshot.amPmShortTime, "--:--");
+    strcpy(snapshot.amPm, "AM");
+    strcpy(snapshot.date, "--------");
+    return;
+  }
+  snapshot.epoch = (long)(now / 1000) + (long)round(myUtcOffset * 3600);
+  tmElements_t tm;
+  breakTime(snapshot.epoch, tm);
+  snapshot.hours = tm.Hour;
+  snapshot.minutes = tm.Minute;
+  snapshot.seconds = tm.Second;
+  snapshot.pm = tm.Hour >= 12;
+  snapshot.amPmHours = tm.Hour % 12 == 0 ? 12 : tm.Hour % 12;
+  snapshot.year = tmYearToCalendar(tm.Year);
+  snapshot.month = tm.Month;
+  snapshot.day = tm.Day;
+
+  snprintf(snapshot.time, sizeof(snapshot.time), "%02d:%02d:%02d", snapshot.hours, snapshot.minutes, snapshot.seconds);
+  snprintf(snapshot.amPmTime, sizeof(snapshot.amPmTime), "%d:%02d:%02d", snapshot.amPmHours, snapshot.minutes, snapshot.seconds);
+  snprintf(snapshot.shortTime, sizeof(snapshot.shortTime), "%02d:%02d", snapshot.hours, snapshot.minutes);
+  snprintf(snapshot.amPmShortTime, sizeof(snapshot.amPmShortTime), "%d:%02d", snapshot.amPmHours, snapshot.minutes);
+  strcpy(snapshot.amPm, snapshot.pm ? "PM" : "AM");
+  snprintf(snapshot.date, sizeof(snapshot.date), "%04d-%02d-%02d", snapshot.year, snapshot.month, snapshot.day);
+}
+
+const TimeSnapshot &TimeClient::getSnapshot() {
+  if (snapshotStale || (long)(millis() - nextSnapshotMillis) >= 0) {
+    refreshSnapshot();
+  }
+  return snapshot;
+}
 
+String TimeClient::getHours() {
+  const TimeSnapshot &now = getSnapshot();
+  if (!now.valid) {
+    return "--";
+  }
+  return String(now.time).substring(0, 2);
 }
+
 String TimeClient::getMinutes() {
-    if (localEpoc == 0) {
-      return "--";
-    }
-    int minutes = ((getCurrentEpochWithUtcOffset() % 3600) / 60);
-    if (minutes < 10 ) {
-      // In the first 10 minutes of each hour, we'll want a leading '0'
-      return "0" + String(minutes);
-    }
-    return String(minutes);
+  const TimeSnapshot &now = getSnapshot();
+  if (!now.valid) {
+    return "--";
+  }
+  return String(now.time).substring(3, 5);
 }
+
 String TimeClient::getSeconds() {
-    if (localEpoc == 0) {
-      return "--";
-    }
-    int seconds = getCurrentEpochWithUtcOffset() % 60;
-    if ( seconds < 10 ) {
-      // In the first 10 seconds of each minute, we'll want a leading '0'
-      return "0" + String(seconds);
-    }
-    return String(seconds);
+  const TimeSnapshot &now = getSnapshot();
+  if (!now.valid) {
+    return "--";
+  }
+  return String(now.time).substring(6, 8);
 }
 
 String TimeClient::getAmPmHours() {
-	int hours = getHours().toInt();
-	if (hours >= 13) {
-		hours = hours - 12;
-	}
-	if (hours == 0) {
-		hours = 12;
-	}
-	return String(hours);
+  const TimeSnapshot &now = getSnapshot();
+  if (!now.valid) {
+    return "12";
+  }
+  return String(now.amPmHours);
 }
 
 String TimeClient::getAmPm() {
-	int hours = getHours().toInt();
-	String ampmValue = "AM";
-	if (hours >= 12) {
-		ampmValue = "PM";
-	}
-	return ampmValue;
+  return getSnapshot().amPm;
 }
 
 String TimeClient::getYear() {
-    if (localEpoc == 0) {
-      return "--";
-    }
-    int _year = year(getCurrentUnixEpoch() + (myUtcOffset * 3600));
-    return String(_year);
+  const TimeSnapshot &now = getSnapshot();
+  if (!now.valid) {
+    return "--";
+  }
+  return String(now.year);
 }
 
 String TimeClient::getMonth() {
-    if (localEpoc == 0) {
-      return "--";
-    }
-    int _month = month(getCurrentUnixEpoch() + (myUtcOffset * 3600));
-    if (_month < 10) {
-      return "0" + String(_month);
-    }
-    return String(_month);
+  const TimeSnapshot &now = getSnapshot();
+  if (!now.valid) {
+    return "--";
+  }
+  return String(now.date).substring(5, 7);
 }
 
 String TimeClient::getDay() {
-    if (localEpoc == 0) {
-      return "--";
-    }
-    int _day = day(getCurrentUnixEpoch() + (myUtcOffset * 3600));
-    if (_day < 10) {
-      return "0" + String(_day);
-    }
-    return String(_day);
+  const TimeSnapshot &now = getSnapshot();
+  if (!now.valid) {
+    return "--";
+  }
+  return String(now.date).substring(8, 10);
 }
 
 String TimeClient::getFormattedDate() {
-  return getYear() + "-" + getMonth() + "-" + getDay();
+  return getSnapshot().date;
 }
 
 String TimeClient::getFormattedTime() {
-  return getHours() + ":" + getMinutes() + ":" + getSeconds();
+  return getSnapshot().time;
 }
 
 String TimeClient::getAmPmFormattedTime() {
-	return getAmPmHours() + ":" + getMinutes() + " " + getAmPm();
+  const TimeSnapshot &now = getSnapshot();
+  return String(now.amPmShortTime) + " " + now.amPm;
 }
 
 long TimeClient::getCurrentEpoch() {
-  return localEpoc + ((millis() - localMillisAtUpdate) / 1000);
+  return getCurrentMillis(millis()) / 1000;
 }
 
+// seconds into the local day
 long TimeClient::getCurrentEpochWithUtcOffset() {
-  return (long)round(getCurrentEpoch() + 3600 * myUtcOffset + 86400L) % 86400L;
+  return (getLocalUnixEpoch() % 86400L + 86400L) % 86400L;
 }
 
 long TimeClient::getCurrentUnixEpoch() {
-  return unixEpoc + ((millis() - localMillisAtUpdate) / 1000);
+  return getCurrentEpoch();
+}
+
+// the offset is added as whole seconds, a float cannot hold a unix epoch to the second
+long TimeClient::getLocalUnixEpoch() {
+  return getCurrentEpoch() + (long)round(myUtcOffset * 3600);
+}
+
+long TimeClient::getLastRoundTrip() {
+  return lastRoundTrip;
+}
+
+long TimeClient::getLastCorrection() {
+  return lastCorrection;
+}
+
+// seconds the clock jumped at the last sync, for timers kept in epoch seconds
+long TimeClient::getLastStep() {
+  return lastStep;
+}
+
+float TimeClient::getDriftPpm() {
+  return driftPpm;
+}
+
+unsigned long TimeClient::getSyncInterval() {
+  return syncInterval;
 }
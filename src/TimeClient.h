@@ -30,25 +30,112 @@ Modified by David Payne for use in the Scrolling Marquee
 #pragma once
 
 #include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
+#include "DnsCache.h"
+#include "FixedString.h"
 
 #define NTP_PACKET_SIZE 48
+#define NTP_PORT 123
+#define NTP_LOCAL_PORT 2390
+#define NTP_TIMEOUT 2000            // ms one server gets to answer before the next one is tried
+#define NTP_UNIX_OFFSET 2208988800UL // seconds from 1900 (NTP) to 1970 (unix)
+#define NTP_DEFAULT_SERVERS "pool.ntp.org,time.google.com,time.nist.gov"
+#define NTP_SERVER_LIST_SIZE 120    // characters of the comma separated server list
+#define NTP_SYNC_MIN 900000         // ms between syncs while the drift is still being learned (15 minutes)
+#define NTP_SYNC_MAX 14400000       // ms between syncs once the clock holds (4 hours)
+#define NTP_SYNC_RETRY 60000        // ms before a failed sync is tried again
+#define NTP_TARGET_ERROR 250        // ms of error found at a sync that is still acceptable
+#define NTP_DRIFT_MIN_SPAN 600000   // ms between two syncs before they are used to measure drift
+#define NTP_DRIFT_LIMIT 500         // ppm, anything larger is a bad measurement rather than the crystal
+#define NTP_REBASE_INTERVAL 86400000 // ms after which the clock is re-anchored, long before millis() wraps
 
+// Local time broken down once per second, so the display reads integers and
+// ready made strings instead of formatting the time on every frame
+typedef struct {
+  boolean valid = false;       // false until the first sync
+  long epoch = 0;              // local unix seconds
+  uint8_t hours = 0;
+  uint8_t amPmHours = 12;
+  uint8_t minutes = 0;
+  uint8_t seconds = 0;
+  boolean pm = false;
+  int year = 0;
+  uint8_t month = 0;
+  uint8_t day = 0;
+  char time[9] = "--:--:--";   // HH:MM:SS
+  char amPmTime[9] = "--:--:--"; // H:MM:SS
+  char shortTime[6] = "--:--"; // HH:MM
+  char amPmShortTime[6] = "--:--"; // H:MM
+  char amPm[3] = "AM";
+  char date[11] = "--------";  // YYYY-MM-DD
+} TimeSnapshot;
+
+// SNTP client. updateTime() sends one 48 byte request and handle() picks up
+// the answer from loop(); nothing blocks. The reply is corrected for half the
+// network round trip and kept to the millisecond.
+// The crystal error measured between syncs is corrected for continuously,
+// so the time between syncs can grow from 15 minutes to a few hours.
 class TimeClient {
 
   private:
+    enum SntpState {
+      SNTP_IDLE,
+      SNTP_RESOLVING,
+      SNTP_WAITING
+    };
+
     float myUtcOffset = 0;
     long localEpoc = 0;
-    long unixEpoc;
-    long localMillisAtUpdate;
-    const char* ntpServerName = "www.google.com";
-    const int httpPort = 80;    
+    unsigned long localMillisAtUpdate = 0;
+    FixedString<NTP_SERVER_LIST_SIZE> serverList = NTP_DEFAULT_SERVERS;
+    int serverIndex = 0;
+    char currentServer[64] = "";
+    IPAddress serverAddress;
+    WiFiUDP udp;
+    boolean udpStarted = false;
+    SntpState state = SNTP_IDLE;
+    unsigned long stateStarted = 0;
+    unsigned long sentMicros = 0;
     byte packetBuffer[ NTP_PACKET_SIZE]; //buffer to hold incoming and outgoing packets
+    byte requestCookie[8];             // our transmit timestamp, echoed back as the origin timestamp
+    long lastRoundTrip = 0;
+    long lastCorrection = 0;
+    long lastStep = 0;
+
+    float driftPpm = 0;
+    boolean driftKnown = false;
+    unsigned long driftMillis = 0;      // millis() at the sync drift is measured from
+    uint64_t driftEpochMillis = 0;      // and the server time at that moment
+    unsigned long syncInterval = NTP_SYNC_MIN;
+    unsigned long lastSyncAttempt = 0;
+    boolean syncRequested = true;
+    boolean lastSyncFailed = false;
+
+    TimeSnapshot snapshot;
+    unsigned long nextSnapshotMillis = 0;
+    boolean snapshotStale = true;
+
+    boolean selectServer(int index);
+    void startServer();
+    void sendRequest();
+    boolean readResponse();
+    uint32_t readWord(int offset);
+    void updateDrift(uint64_t now, unsigned long receivedMillis);
+    void updateSyncInterval();
+    uint64_t getCurrentMillis(unsigned long at);
+    void refreshSnapshot();
+    long getLocalUnixEpoch();
 
   public:
     TimeClient(float utcOffset);
     void updateTime();
-    
+    boolean handle();
+    boolean isBusy();
+    boolean isSyncDue();
+    void setServers(const char* servers);
+
     void setUtcOffset(float utcOffset);
+    const TimeSnapshot &getSnapshot();
     String getHours();
     String getAmPmHours();
     String getAmPm();
@@ -63,4 +150,9 @@ class TimeClient {
     long getCurrentEpoch();
     long getCurrentEpochWithUtcOffset();
     long getCurrentUnixEpoch();
+    long getLastRoundTrip();
+    long getLastCorrection();
+    long getLastStep();
+    float getDriftPpm();
+    unsigned long getSyncInterval();
 };
@@ -0,0 +1,395 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#include "WebSocketClient.h"
+
+// Opens the socket once the host name is resolved; handle() keeps trying
+// while the lookup is pending. False if the connection failed right away.
+boolean WebSocketClient::connect(const char* host, int port, const char* path, const char* extraHeaders) {
+  close();
+  error[0] = '\0';
+  snprintf(this->host, sizeof(this->host), "%s", host);
+  this->port = port;
+  snprintf(this->path, sizeof(this->path), "%s", path);
+  snprintf(this->extraHeaders, sizeof(this->extraHeaders), "%s", extraHeaders);
+  lastActivity = millis();
+  state = WS_RESOLVING;
+  return open();
+}
+
+boolean WebSocketClient::open() {
+  // the REST requests to the same host normally have the address cached already
+  IPAddress address;
+  DnsResult dns = dnsCache.resolve(host, address);
+  if (dns == DNS_PENDING) {
+    return true;
+  }
+  if (dns == DNS_FAILED) {
+    fail("WebSocket could not resolve %s", host);
+    return false;
+  }
+  client.setTimeout(WS_CONNECT_TIMEOUT);
+  if (!client.connect(address, port)) {
+    fail("WebSocket connection to %s:%d failed.", host, port);
+    return false;
+  }
+  client.setNoDelay(true);
+
+  uint8_t nonce[16];
+  for (int inx = 0; inx < 16; inx++) {
+    nonce[inx] = random(256);
+  }
+  char request[WS_REQUEST_SIZE];
+  int length = snprintf(request, sizeof(request),
+    "GET %s HTTP/1.1\r\nHost: %s:%d\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: %s\r\n"
+    "Sec-WebSocket-Version: 13\r\nUser-Agent: ArduinoWiFi/1.1\r\n%s\r\n",
+    path, host, port, base64::encode(nonce, sizeof(nonce), false).c_str(), extraHeaders);
+  if (length >= (int)sizeof(request)) {
+    fail("WebSocket upgrade request too long");
+    return false;
+  }
+  if (client.write((const uint8_t*)request, length) != (size_t)length) {
+    fail("WebSocket connection to %s:%d failed.", host, port);
+    return false;
+  }
+
+  lineLength = 0;
+  statusCode = 0;
+  upgraded = false;
+  headerLength = 0;
+  headerNeeded = 2;
+  skipping = false;
+  overflow = false;
+  messageLength = 0;
+  messageReady = false;
+  lastActivity = millis();
+  state = WS_HANDSHAKE;
+  return true;
+}
+
+boolean WebSocketClient::handle() {
+  if (messageReady) {
+    // the previous message has been handed out, release it
+    messageReady = false;
+    messageLength = 0;
+  }
+  if (state == WS_CLOSED) {
+    return false;
+  }
+  if (state == WS_RESOLVING) {
+    if (millis() - lastActivity > WS_CONNECT_TIMEOUT) {
+      fail("WebSocket could not resolve %s", host);
+    } else {
+      open();
+    }
+    return false;
+  }
+  if (!client.available() && !client.connected()) {
+    fail("WebSocket connection closed by server");
+    return false;
+  }
+
+  unsigned long start = millis();
+  while (state != WS_CLOSED && !messageReady && client.available() && millis() - start < WS_LOOP_BUDGET) {
+    lastActivity = millis();
+    if (state == WS_HANDSHAKE) {
+      readHandshake();
+    } else {
+      readFrame();
+    }
+  }
+
+  if (state == WS_HANDSHAKE && millis() - lastActivity > WS_HANDSHAKE_TIMEOUT) {
+    fail("WebSocket handshake timed out");
+  } else if (state == WS_OPEN && millis() - lastActivity > WS_IDLE_TIMEOUT) {
+    fail("WebSocket connection idle, closing");
+  }
+  return messageReady;
+}
+
+void WebSocketClient::readHandshake() {
+  while (state == WS_HANDSHAKE && client.available()) {
+    char c = client.read();
+    if (c == '\r') {
+      continue;
+    }
+    if (c != '\n') {
+      if (lineLength >= WS_LINE_SIZE - 1) {
+        fail("WebSocket handshake line too long");
+        return;
+      }
+      line[lineLength++] = c;
+      continue;
+    }
+    line[lineLength] = '\0';
+    handshakeLine();
+    lineLength = 0;
+  }
+}
+
+// One line of the upgrade response; the connection is open after the empty one
+void WebSocketClient::handshakeLine() {
+  if (statusCode == 0) {
+    const char* space = strchr(line, ' ');
+    statusCode = space != NULL ? atoi(space + 1) : -1;
+    if (statusCode != 101) {
+      fail("WebSocket upgrade refused: %s", line);
+    }
+  } else if (lineLength == 0) {
+    if (!upgraded) {
+      fail("WebSocket upgrade refused: no upgrade header");
+      return;
+    }
+    state = WS_OPEN;
+    Serial.println("WebSocket connected");
+    // anything left is frame data
+  } else if (strncasecmp(line, "upgrade:", 8) == 0) {
+    const char* value = line + 8;
+    while (*value == ' ' || *value == '\t') {
+      value++;
+    }
+    upgraded = strncasecmp(value, "websocket", 9) == 0;
+  }
+}
+
+void WebSocketClient::readFrame() {
+  while (headerLength < headerNeeded) {
+    if (!client.available()) {
+      return;
+    }
+    header[headerLength++] = client.read();
+    if (headerLength == 2) {
+      uint8_t length7 = header[1] & 0x7F;
+      headerNeeded = 2 + (length7 == 126 ? 2 : (length7 == 127 ? 8 : 0)) + ((header[1] & 0x80) ? 4 : 0);
+    }
+  }
+  if (headerLength == headerNeeded && payloadRead == 0 && headerNeeded > 0) {
+    parseHeader();
+    if (state != WS_OPEN) {
+      return;
+    }
+    headerNeeded = 0; // header consumed, now reading the payload
+  }
+
+  uint8_t buffer[128];
+  while (payloadRead < payloadLength && client.available()) {
+    size_t wanted = payloadLength - payloadRead;
+    if (wanted > sizeof(buffer)) {
+      wanted = sizeof(buffer);
+    }
+    int count = client.read(buffer, wanted);
+    if (count <= 0) {
+      return;
+    }
+    if (masked) {
+      for (int inx = 0; inx < count; inx++) {
+        buffer[inx] ^= mask[(payloadRead + inx) & 3];
+      }
+    }
+    if (opcode >= WS_CLOSE) {
+      memcpy(control + controlLength, buffer, count);
+      controlLength += count;
+    } else if (!skipping) {
+      if (stream != NULL) {
+        stream->feed((const char*)buffer, count);
+      }
+      if (!overflow) {
+        memcpy(message + messageLength, buffer, count);
+        messageLength += count;
+      }
+    }
+    payloadRead += count;
+  }
+  if (payloadRead >= payloadLength) {
+    frameComplete();
+  }
+}
+
+void WebSocketClient::parseHeader() {
+  finalFrame = header[0] & 0x80;
+  opcode = header[0] & 0x0F;
+  masked = header[1] & 0x80;
+  payloadLength = header[1] & 0x7F;
+  int pos = 2;
+  if (payloadLength == 126) {
+    payloadLength = ((unsigned long)header[2] << 8) | header[3];
+    pos = 4;
+  } else if (payloadLength == 127) {
+    payloadLength = 0;
+    for (int inx = 2; inx < 10; inx++) {
+      payloadLength = (payloadLength << 8) | header[inx];
+    }
+    pos = 10;
+  }
+  if (masked) {
+    memcpy(mask, header + pos, 4);
+  }
+  payloadRead = 0;
+
+  if (opcode >= WS_CLOSE) {
+    if (payloadLength > sizeof(control)) {
+      fail("WebSocket protocol error");
+      return;
+    }
+    controlLength = 0;
+    return;
+  }
+  if (opcode != WS_CONTINUATION) {
+    messageOpcode = opcode;
+    messageLength = 0;
+    skipping = (opcode != WS_TEXT);
+    overflow = false;
+    if (!skipping && stream != NULL) {
+      stream->begin();
+    }
+  }
+  if (!skipping && !overflow && messageLength + payloadLength > WS_MAX_MESSAGE) {
+    overflow = true;
+    messageLength = 0;
+    if (stream == NULL) {
+      Serial.println("WebSocket message too large, skipping");
+      skipping = true;
+    }
+  }
+}
+
+void WebSocketClient::frameComplete() {
+  headerLength = 0;
+  headerNeeded = 2;
+  payloadLength = 0;
+  payloadRead = 0;
+  switch (opcode) {
+    case WS_PING:
+      sendFrame(WS_PONG, control, controlLength);
+      break;
+    case WS_CLOSE:
+      sendFrame(WS_CLOSE, control, controlLength < 2 ? controlLength : 2);
+      fail("WebSocket closed by server");
+      break;
+    case WS_PONG:
+      break;
+    default:
+      if (finalFrame) {
+        if (!skipping && messageOpcode == WS_TEXT) {
+          message[messageLength] = '\0';
+          messageReady = true;
+        }
+        skipping = false;
+      }
+      break;
+  }
+}
+
+boolean WebSocketClient::send(const char* text) {
+  if (state != WS_OPEN) {
+    return false;
+  }
+  return sendFrame(WS_TEXT, (const uint8_t*)text, strlen(text));
+}
+
+// Client frames are always masked (RFC 6455 5.3)
+boolean WebSocketClient::sendFrame(uint8_t frameOpcode, const uint8_t* data, size_t length) {
+  if (length > 0xFFFF) {
+    return false;
+  }
+  uint8_t buffer[136];
+  size_t pos = 0;
+  buffer[pos++] = 0x80 | frameOpcode;
+  if (length < 126) {
+    buffer[pos++] = 0x80 | length;
+  } else {
+    buffer[pos++] = 0x80 | 126;
+    buffer[pos++] = length >> 8;
+    buffer[pos++] = length & 0xFF;
+  }
+  uint8_t frameMask[4];
+  for (int inx = 0; inx < 4; inx++) {
+    frameMask[inx] = random(256);
+    buffer[pos++] = frameMask[inx];
+  }
+  for (size_t inx = 0; inx < length; inx++) {
+    if (pos == sizeof(buffer)) {
+      if (client.write(buffer, pos) != pos) {
+        return false;
+      }
+      pos = 0;
+    }
+    buffer[pos++] = data[inx] ^ frameMask[inx & 3];
+  }
+  return client.write(buffer, pos) == pos;
+}
+
+void WebSocketClient::close() {
+  if (state == WS_OPEN) {
+    sendFrame(WS_CLOSE, NULL, 0);
+  }
+  client.stop();
+  state = WS_CLOSED;
+  messageLength = 0;
+  messageReady = false;
+}
+
+// The message is formatted straight into the error buffer
+void WebSocketClient::fail(const char* pattern, ...) {
+  client.stop();
+  state = WS_CLOSED;
+  messageLength = 0;
+  messageReady = false;
+  va_list args;
+  va_start(args, pattern);
+  vsnprintf(error, sizeof(error), pattern, args);
+  va_end(args);
+  Serial.println(error);
+}
+
+boolean WebSocketClient::isConnected() {
+  return state == WS_OPEN;
+}
+
+boolean WebSocketClient::isClosed() {
+  return state == WS_CLOSED;
+}
+
+// Text messages are fed to the extractor as they arrive, from the next message on
+void WebSocketClient::setStream(JsonStreamExtractor* extractor) {
+  stream = extractor;
+}
+
+// False if the message was too large for the buffer and only went to the stream
+boolean WebSocketClient::isMessageBuffered() {
+  return messageReady && !overflow;
+}
+
+// Valid until the next handle(); may be parsed in place
+char* WebSocketClient::getMessage() {
+  return message;
+}
+
+size_t WebSocketClient::getMessageLength() {
+  return messageLength;
+}
+
+String WebSocketClient::getError() {
+  return error;
+}
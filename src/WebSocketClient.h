@@ -0,0 +1,119 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+#pragma once
+#include <ESP8266WiFi.h>
+#include <base64.h>
+#include "DnsCache.h"
+#include "JsonStreamExtractor.h"
+
+#define WS_CONNECT_TIMEOUT 3000     // ms allowed for the TCP connect
+#define WS_HANDSHAKE_TIMEOUT 5000   // ms the server may take to accept the upgrade
+#define WS_IDLE_TIMEOUT 30000       // ms without any data before the socket is considered dead
+#define WS_MAX_MESSAGE 4096         // larger messages are skipped, or only streamed if setStream() was given an extractor
+#define WS_LINE_SIZE 128            // longest handshake header line, longer ones are rejected
+#define WS_REQUEST_SIZE 512         // the upgrade request with its headers
+#define WS_ERROR_SIZE 128           // the last failure, e.g. "WebSocket connection to <host>:<port> failed."
+#define WS_LOOP_BUDGET 5            // ms of work done per handle() call
+
+// Minimal RFC 6455 client: text messages only, no extensions. Frames are read
+// a few milliseconds at a time from loop(); handle() returns true once a
+// complete text message is available from getMessage(). Messages are received
+// into a fixed buffer, so reading them does not touch the heap. With setStream()
+// text messages are also fed to an extractor as they arrive, whatever their size.
+class WebSocketClient {
+
+private:
+  enum WsState {
+    WS_CLOSED,
+    WS_RESOLVING,
+    WS_HANDSHAKE,
+    WS_OPEN
+  };
+
+  enum WsOpcode {
+    WS_CONTINUATION = 0x0,
+    WS_TEXT = 0x1,
+    WS_BINARY = 0x2,
+    WS_CLOSE = 0x8,
+    WS_PING = 0x9,
+    WS_PONG = 0xA
+  };
+
+  WsState state = WS_CLOSED;
+  WiFiClient client;
+  char host[100] = "";
+  int port = 0;
+  char path[100] = "";
+  char extraHeaders[160] = "";
+  char line[WS_LINE_SIZE];
+  size_t lineLength = 0;
+  int statusCode = 0;
+  boolean upgraded = false;
+  unsigned long lastActivity = 0;
+
+  uint8_t header[14];
+  int headerLength = 0;
+  int headerNeeded = 2;
+  uint8_t opcode = 0;
+  uint8_t messageOpcode = 0;
+  boolean finalFrame = false;
+  boolean masked = false;
+  uint8_t mask[4];
+  unsigned long payloadLength = 0;
+  unsigned long payloadRead = 0;
+  boolean skipping = false;
+  boolean overflow = false;     // the message did not fit the buffer
+  JsonStreamExtractor* stream = NULL;
+  uint8_t control[125];
+  int controlLength = 0;
+
+  char message[WS_MAX_MESSAGE + 1];
+  size_t messageLength = 0;
+  boolean messageReady = false;
+  char error[WS_ERROR_SIZE] = "";
+
+  boolean open();
+  void readHandshake();
+  void readFrame();
+  void parseHeader();
+  void frameComplete();
+  boolean sendFrame(uint8_t frameOpcode, const uint8_t* data, size_t length);
+  void handshakeLine();
+  void fail(const char* pattern, ...) __attribute__ ((format (printf, 2, 3)));
+
+public:
+  boolean connect(const char* host, int port, const char* path, const char* extraHeaders);
+  boolean handle();
+  boolean send(const char* text);
+  void setStream(JsonStreamExtractor* extractor);
+  void close();
+
+  boolean isConnected();
+  boolean isClosed();
+  char* getMessage();
+  size_t getMessageLength();
+  boolean isMessageBuffered();
+  String getError();
+};
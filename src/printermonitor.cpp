@@ -34,28 +34,27 @@ SOFTWARE.
 
 #include "TimeLib.h"
 #include <Timezone.h>   // https://github.com/JChristensen/Timezone
+#include "DstCache.h"
 
 #include <PubSubClient.h>
 char mqttClientName[32] = "";
 
-unsigned long mqttPreviousTime;
-
 WiFiClient wifiClient;
 PubSubClient mqtt(MqttServer.c_str(), MqttPort, wifiClient);
 
 void mqttCallback(char* topic, byte* payload, unsigned int length);
 bool mqttConnect();
 void mqttHandle();
+void mqttReconnect();
 
 float extTemp0 = -127.0;
 float extHumd0 = -127.0;
 
-boolean EspShouldReboot = false;
-
 // Eastern European Time Zone (Vilnius, LT)
 TimeChangeRule myDST = {"SEET", Last, Sun, Mar, 3, +180};   // Daylight time = +3 hours
 TimeChangeRule mySTD = {"WEET", Last, Sun, Oct, 2, +120};   // Standard time = +2 hours
 Timezone myTZ(myDST, mySTD);
+DstCache dstCache(myTZ);
 
 #define VERSION "3.9"
 
@@ -86,6 +85,13 @@ Timezone myTZ(myDST, mySTD);
 
 OLEDDisplayUi   ui( &display );
 
+// Message shown full screen while the display goes to sleep or wakes up
+enum DisplayBanner {
+  BANNER_NONE,
+  BANNER_SLEEP,
+  BANNER_WAKE
+};
+
 void readSettings();
 void displayPrinterStatus();
 void handleSystemReset();
@@ -98,23 +104,30 @@ void checkDisplay();
 void enableDisplay(boolean enable);
 void refreshBrightness();
 void refreshBrightness(bool force);
-String zeroPad(int value);
 String getTempSymbol();
 String getTempSymbol(boolean forHTML);
 String getSpeedSymbol();
 void drawRssi(OLEDDisplay *display);
 void redirectHome();
-String getHeader();
-String getHeader(boolean refresh);
-String getFooter();
+void printHeader(PageWriter &page, boolean refresh);
+void printFooter(PageWriter &page);
 void ledOnOff(boolean value);
 void flashLED(int number, int delayTime);
 void findMDNS();
 void writeSettings();
-void getUpdateTime();
+void getUpdateWeather();
 void setUtcOffset();
-int getMinutesFromLastRefresh();
+void scheduleTasks();
+void pollPrinter();
+void syncTime();
+void reportStats();
+void reboot();
+void showBanner(DisplayBanner banner, const char* text);
+void endBanner();
 void updateTime();
+#ifdef DST_BENCHMARK
+void benchmarkDst();
+#endif
 
 void drawProgress(OLEDDisplay *display, int percentage, String label);
 void drawOtaProgress(unsigned int, unsigned int);
@@ -147,23 +160,28 @@ TimeClient timeClient(UtcOffset);
 long lastEpoch = 0;
 long firstEpoch = 0;
 long displayOffEpoch = 0;
-String lastMinute = "xx";
-String lastSecond = "xx";
+boolean isLedOn = false;
 String lastReportStatus = "";
 boolean displayOn = true;
+AllocationCounter allocationCounter;
+CoopScheduler scheduler;
+int weatherTask = -1;
+DisplayBanner displayBanner = BANNER_NONE;
+const unsigned long BANNER_TIME = 5000; // ms a sleep / wake message stays on the screen
 
 #if defined(PRINTER_MON)
 // Printer Client
 #if defined(USE_REPETIER_CLIENT)
-  RepetierClient printerClient(PrinterApiKey, PrinterServer, PrinterPort, PrinterAuthUser, PrinterAuthPass, HAS_PSU);
+  RepetierClient printerClient(PrinterApiKey.c_str(), PrinterServer.c_str(), PrinterPort, PrinterAuthUser.c_str(), PrinterAuthPass.c_str(), HAS_PSU);
 #else
-  OctoPrintClient printerClient(PrinterApiKey, PrinterServer, PrinterPort, PrinterAuthUser, PrinterAuthPass, HAS_PSU);
+  OctoPrintClient printerClient(PrinterApiKey.c_str(), PrinterServer.c_str(), PrinterPort, PrinterAuthUser.c_str(), PrinterAuthPass.c_str(), HAS_PSU);
 #endif
 int printerCount = 0;
+PollScheduler pollScheduler;
 #endif
 
 // Weather Client
-OpenWeatherMapClient weatherClient(WeatherApiKey, CityIDs, 1, IS_METRIC, WeatherLanguage);
+OpenWeatherMapClient weatherClient(WeatherApiKey.c_str(), CityIDs, 1, IS_METRIC, WeatherLanguage.c_str());
 
 //declairing prototypes
 void configModeCallback (WiFiManager *myWiFiManager);
@@ -179,8 +197,6 @@ static const char WEB_ACTIONS[] PROGMEM =  "<a class='w3-bar-item w3-button' hre
                       "<a class='w3-bar-item w3-button' href='/forgetwifi' onclick='return confirm(\"Do you want to forget to WiFi connection?\")'><i class='fa fa-wifi'></i> Forget WiFi</a>"
                       "<a class='w3-bar-item w3-button' href='/update'><i class='fa fa-wrench'></i> Firmware Update</a>";
 
-String CHANGE_FORM =  ""; // moved to config to make it dynamic
-
 #if defined(PRINTER_MON)
 static const char CLOCK_FORM[] PROGMEM = "<hr><p><input name='isClockEnabled' class='w3-check w3-margin-top' type='checkbox' %IS_CLOCK_CHECKED%> Display Clock when printer is off</p>"
 #else
@@ -192,11 +208,23 @@ static const char CLOCK_FORM[] PROGMEM = "<hr><p><input name='isClockEnabled' cl
 #if defined(PRINTER_MON)
                       "<p><input name='hasPSU' class='w3-check w3-margin-top' type='checkbox' %HAS_PSU_CHECKED%> Use OctoPrint PSU control plugin for clock/blank</p>"
 #endif
-                      "<p>Clock Sync / Weather Refresh (minutes) <select class='w3-option w3-padding' name='refresh'>%OPTIONS%</select></p>";
+                      "<p>Weather Refresh (minutes) <select class='w3-option w3-padding' name='refresh'>%OPTIONS%</select></p>";
+
+static const char REFRESH_OPTIONS[] PROGMEM = "<option>10</option><option>15</option><option>20</option><option>30</option><option>60</option>";
+
+#if defined(PRINTER_MON)
+static const char POLL_FORM[] PROGMEM = "<hr><p>Printer poll interval (seconds)</p>"
+                      "<p><label>While heating</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='pollHeating' value='%POLL_HEATING%' maxlength='4' onkeypress='return isNumberKey(event)'></p>"
+                      "<p><label>While printing</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='pollPrinting' value='%POLL_PRINTING%' maxlength='4' onkeypress='return isNumberKey(event)'></p>"
+                      "<p><label>Last few percent of a print</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='pollFinishing' value='%POLL_FINISHING%' maxlength='4' onkeypress='return isNumberKey(event)'></p>"
+                      "<p><label>Idle</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='pollIdle' value='%POLL_IDLE%' maxlength='4' onkeypress='return isNumberKey(event)'></p>"
+                      "<p><label>Offline or PSU off</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='pollOffline' value='%POLL_OFFLINE%' maxlength='4' onkeypress='return isNumberKey(event)'></p>";
+#endif
 
 static const char THEME_FORM[] PROGMEM =   "<p>Theme Color <select class='w3-option w3-padding' name='theme'>%THEME_OPTIONS%</select></p>"
                       "<p><label>Standard UTC Time Offset (without DST)</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='utcoffset' value='%UTCOFFSET%' maxlength='12'></p>"
-                      "<p><input name='isDSTused' class='w3-check w3-margin-top' type='checkbox' %IS_DST_CHECKED%> Use Daylight Saving Time (DST)</p><hr>"
+                      "<p><input name='isDSTused' class='w3-check w3-margin-top' type='checkbox' %IS_DST_CHECKED%> Use Daylight Saving Time (DST)</p>"
+                      "<p><label>Time Servers (comma separated)</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='ntpServers' value='%NTPSERVERS%' maxlength='120'></p><hr>"
                       "<p><label>Day Time OLED Brightness (0-255)</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='daytimebrightness' value='%DAYTIMEBRIGHTNESS%' maxlength='3'></p><hr>"
                       "<p><label>Night Time OLED Brightness (0-255)</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='nighttimebrightness' value='%NIGHTTIMEBRIGHTNESS%' maxlength='3'></p><hr>"
                       "<p><input name='isBasicAuth' class='w3-check w3-margin-top' type='checkbox' %IS_BASICAUTH_CHECKED%> Use Security Credentials for Configuration Changes</p>"
@@ -311,6 +339,9 @@ void setup() {
 #endif
 
   readSettings();
+#ifdef DST_BENCHMARK
+  benchmarkDst();
+#endif
 
   // initialize display
   display.init();
@@ -370,13 +401,11 @@ void setup() {
     strcpy(mqttClientName, mqttClientId.c_str());
     mqtt.setServer(MqttServer.c_str(), MqttPort);
     mqtt.setCallback(mqttCallback);
-    if (mqttConnect()) {
-      mqttPreviousTime = millis();
-    } else {
-      mqttPreviousTime = 0;
-    }
+    mqttConnect(); // retried by the mqtt task while the broker is away
   }
 
+  scheduleTasks();
+
   // You can change the transition that is used
   // SLIDE_LEFT, SLIDE_RIGHT, SLIDE_TOP, SLIDE_DOWN
   ui.setFrameAnimation(SLIDE_LEFT);
@@ -487,17 +516,17 @@ void findMDNS() {
     Serial.println("no services found - make sure Printer server is turned on");
     return;
   }
-  Serial.println("*** Looking for " + PrinterHostName + " over mDNS");
+  Serial.printf("*** Looking for %s over mDNS\n", PrinterHostName.c_str());
   for (int i = 0; i < n; ++i) {
     // Going through every available service,
     // we're searching for the one whose hostname
     // matches what we want, and then get its IP
     Serial.println("Found: " + MDNS.hostname(i));
-    if (MDNS.hostname(i) == PrinterHostName) {
+    if (PrinterHostName == MDNS.hostname(i)) {
       IPAddress serverIp = MDNS.IP(i);
       PrinterServer = serverIp.toString();
       PrinterPort = MDNS.port(i); // save the port
-      Serial.println("*** Found Printer Server " + PrinterHostName + " http://" + PrinterServer + ":" + PrinterPort);
+      Serial.printf("*** Found Printer Server %s http://%s:%d\n", PrinterHostName.c_str(), PrinterServer.c_str(), PrinterPort);
       writeSettings(); // update the settings
     }
   }
@@ -529,11 +558,11 @@ void mqttCallback(char *topic, byte *payload, unsigned int length) {
   Serial.printf("MQTT topic %s, message received: %s, length: %d\n", topic, message, length);
 
   // decode message
-  if (String(topic) == MqttTempTopic) {
+  if (MqttTempTopic == topic) {
     extTemp0 = atof(message);
-  } else if (String(topic) == MqttHumdTopic) {
+  } else if (MqttHumdTopic == topic) {
     extHumd0 = atof(message);
-  } else if (String(topic) == MqttLwtTopic) {
+  } else if (MqttLwtTopic == topic) {
     Serial.println("LWT changed");
     String lwt = String(message);
     lwt.toUpperCase();
@@ -545,26 +574,28 @@ void mqttCallback(char *topic, byte *payload, unsigned int length) {
 }
 
 void mqttHandle() {
-  if (!mqtt.connected()) {
-    extTemp0 = -127.0;
-    extHumd0 = -127.0;
-    unsigned long mqttCurrentTime = millis();
-    if (mqttCurrentTime - mqttPreviousTime > 5000) {
-      mqttPreviousTime = mqttCurrentTime;
-      if (mqttConnect()) {
-        Serial.println(F("MQTT disconnected, successfully reconnected."));
-        mqttPreviousTime = 0;
-      }
-      else Serial.println(F("MQTT disconnected, failed to reconnect."));
-    }
+  if (mqtt.connected()) {
+    mqtt.loop();
+  }
+}
+
+// Scheduled every 5 seconds; reconnects when the broker went away
+void mqttReconnect() {
+  if (!MqttUse || mqtt.connected()) {
+    return;
+  }
+  extTemp0 = -127.0;
+  extHumd0 = -127.0;
+  if (mqttConnect()) {
+    Serial.println(F("MQTT disconnected, successfully reconnected."));
   }
-  else mqtt.loop();
+  else Serial.println(F("MQTT disconnected, failed to reconnect."));
 }
 
 bool mqttConnect() {
   if (mqtt.connect(mqttClientName, MqttUser.c_str(), MqttPsw.c_str())) {
     Serial.print(F("MQTT connected: "));
-    Serial.println(MqttServer);
+    Serial.println(MqttServer.c_str());
     Serial.println(mqttClientName);
     if (MqttTempTopic != "") {
       mqtt.subscribe(MqttTempTopic.c_str());
@@ -578,74 +609,59 @@ bool mqttConnect() {
   }
   else {
     Serial.print(F("MQTT connection failed: "));
-    Serial.println(MqttServer);
+    Serial.println(MqttServer.c_str());
   }
   return mqtt.connected();
 }
 
 time_t utc;
 time_t local;
+boolean offsetDst = false; // DST state the timeClient offset was last set for
 
 //************************************************************
 // Main Loop
 //************************************************************
 void loop() {
-  if (EspShouldReboot) {
-    static int cnt = millis() + 5000;
-    if (cnt < millis()) {
-      Serial.println("Rebooting...");
-      EspShouldReboot = false;
-      ESP.reset();
-      delay(5000);
-    }
-  }
-
+  ScratchScope scope; // transient text of this pass is dropped on the way out
   if (MqttUse) {
     mqttHandle();
   }
 
-  //Get Time Update
-  if((getMinutesFromLastRefresh() >= minutesBetweenDataRefresh) || lastEpoch == 0) {
-    getUpdateTime();
+  // advance the in-flight network requests
+#if defined(PRINTER_MON)
+  printerClient.handle();
+#endif
+  weatherClient.handle();
+  if (timeClient.handle()) {
+    // keep the refresh timers counting across the clock step
+    if (lastEpoch != 0) {
+      lastEpoch += timeClient.getLastStep();
+    }
+    if (displayOffEpoch != 0) {
+      displayOffEpoch += timeClient.getLastStep();
+    }
+    Serial.println("Local time: " + timeClient.getAmPmFormattedTime());
     setUtcOffset();
   }
 
+  // printer polls, weather, time sync, MQTT and display checks
+  scheduler.run();
+
   updateTime();
 
-  // Check status every 60 seconds
-  if (lastMinute != timeClient.getMinutes()
-#if defined(PRINTER_MON)
-  && !printerClient.isPrinting()
-#endif
-  ) {
-    OLEDDisplayUiState* state = ui.getUiState();
-	  if (state->frameState != IN_TRANSITION  // not update while screen transition in progress (this will feezes transition)
-	    && (state->currentFrame != 0)) {      // not update when showing clock (this will freezes clock seconds)
-  		ledOnOff(true);
-  		lastMinute = timeClient.getMinutes(); // reset the check value
+  // LED is on while any request is in flight
+  boolean networkBusy = weatherClient.isBusy() || timeClient.isBusy();
 #if defined(PRINTER_MON)
-  		printerClient.getPrinterJobResults();
-  		printerClient.getPrinterPsuState();
+  networkBusy = networkBusy || printerClient.isBusy();
 #endif
-  		ledOnOff(false);
-	  }
+  if (networkBusy != isLedOn) {
+    isLedOn = networkBusy;
+    ledOnOff(isLedOn);
   }
-#if defined(PRINTER_MON)
-  else if (printerClient.isPrinting()) {
-    if (lastSecond != timeClient.getSeconds() && timeClient.getSeconds().endsWith("0")) {
-      lastSecond = timeClient.getSeconds();
-      // every 10 seconds while printing get an update
-      ledOnOff(true);
-      printerClient.getPrinterJobResults();
-      printerClient.getPrinterPsuState();
-      ledOnOff(false);
-    }
-  }
-#endif
-
-  checkDisplay(); // Check to see if the printer is on or offline and change display.
 
-  ui.update();
+  if (displayBanner == BANNER_NONE) {
+    ui.update(); // paused while a sleep / wake message is shown
+  }
 
   if (WEBSERVER_ENABLED) {
     server.handleClient();
@@ -655,22 +671,56 @@ void loop() {
   }
 }
 
-void getUpdateTime() {
-  ledOnOff(true); // turn on the LED
+void scheduleTasks() {
+#if defined(PRINTER_MON)
+  scheduler.every("printer", 1000, pollPrinter, COOP_PRIORITY_HIGH, 500);
+#endif
+  scheduler.every("time", 1000, syncTime, COOP_PRIORITY_HIGH);
+  weatherTask = scheduler.every("weather", minutesBetweenDataRefresh * 60000UL, getUpdateWeather, COOP_PRIORITY_NORMAL, 500);
+  scheduler.every("mqtt", 5000, mqttReconnect, COOP_PRIORITY_NORMAL, 3000); // connecting blocks
+  scheduler.every("display", 1000, checkDisplay, COOP_PRIORITY_LOW);
+  scheduler.every("stats", 60000, reportStats, COOP_PRIORITY_LOW);
+}
+
+#if defined(PRINTER_MON)
+// Poll the printer as often as what it is doing deserves
+void pollPrinter() {
+  pollScheduler.setPhase(pollScheduler.classify(printerClient.isOperational(), printerClient.getPrinterState()));
+  if (pollScheduler.isDue()) {
+    pollScheduler.polled();
+    printerClient.getPrinterJobResults();
+    printerClient.getPrinterPsuState();
+  }
+}
+#endif
+
+// Sync the clock, on its own schedule
+void syncTime() {
+  if (timeClient.isSyncDue()) {
+    Serial.println("Updating Time...");
+    timeClient.updateTime();
+  }
+}
+
+// Once a minute; with nothing shown on the web page the allocations should stay 0
+void reportStats() {
+  allocationCounter.report();
+  scheduler.report();
+}
+
+void reboot() {
+  Serial.println("Rebooting...");
+  ESP.reset();
+}
+
+void getUpdateWeather() {
   Serial.println();
 
   if (displayOn && DISPLAYWEATHER) {
     Serial.println("Getting Weather Data...");
     weatherClient.updateWeather();
   }
-
-  Serial.println("Updating Time...");
-  //Update the Time
-  timeClient.updateTime();
-  lastEpoch = timeClient.getCurrentEpoch();
-  Serial.println("Local time: " + timeClient.getAmPmFormattedTime());
-
-  ledOnOff(false);  // turn off the LED
+  lastEpoch = timeClient.getCurrentEpoch(); // result is picked up in loop()
 }
 
 boolean authentication() {
@@ -702,24 +752,24 @@ void handleUpdateWeather() {
   WeatherLanguage = server.arg("language");
   bool _mqttUse = MqttUse;  // last value
   MqttUse = server.hasArg("isMqttEnabled");
-  String _mqttServer = MqttServer;
+  FixedString<39> _mqttServer = MqttServer;
   MqttServer = server.arg("mqttServer");
   int _mqttPort = MqttPort;
   MqttPort = server.arg("mqttPort").toInt();
-  String _mqttUser = MqttUser;
+  FixedString<16> _mqttUser = MqttUser;
   MqttUser = server.arg("mqttUser");
-  String _mqttPsw = MqttPsw;
+  FixedString<16> _mqttPsw = MqttPsw;
   MqttPsw = server.arg("mqttPsw");
-  String _mqttTempTopic = MqttTempTopic;
+  FixedString<128> _mqttTempTopic = MqttTempTopic;
   MqttTempTopic = server.arg("mqttTempTopic");
-  String _mqttHumdTopic = MqttHumdTopic;
+  FixedString<128> _mqttHumdTopic = MqttHumdTopic;
   MqttHumdTopic = server.arg("mqttHumdTopic");
-  String _mqttLwtTopic = MqttLwtTopic;
+  FixedString<128> _mqttLwtTopic = MqttLwtTopic;
   MqttLwtTopic = server.arg("mqttLwtTopic");
   writeSettings();
   isClockOn = false; // this will force a check for the display
   checkDisplay();
-  lastEpoch = 0;
+  scheduler.runNow(weatherTask);
   redirectHome();
   if (_mqttUse != MqttUse
       || _mqttServer != MqttServer
@@ -730,7 +780,7 @@ void handleUpdateWeather() {
       || _mqttHumdTopic != MqttHumdTopic
       || _mqttLwtTopic != MqttLwtTopic) {
     Serial.println("MQTT configuration changed, Restarting ESP...");
-    EspShouldReboot = true;
+    scheduler.once("reboot", 5000, reboot, COOP_PRIORITY_HIGH);
     MqttUse = _mqttUse; // disable MQTT until reboot
   }
 }
@@ -750,6 +800,11 @@ void handleUpdateConfig() {
   PrinterPort = server.arg("PrinterPort").toInt();
   PrinterAuthUser = server.arg("octoUser");
   PrinterAuthPass = server.arg("octoPass");
+  PollHeatingSeconds = server.arg("pollHeating").toInt();
+  PollPrintingSeconds = server.arg("pollPrinting").toInt();
+  PollFinishingSeconds = server.arg("pollFinishing").toInt();
+  PollIdleSeconds = server.arg("pollIdle").toInt();
+  PollOfflineSeconds = server.arg("pollOffline").toInt();
 #endif
   DISPLAYCLOCK = server.hasArg("isClockEnabled");
   IS_24HOUR = server.hasArg("is24hour");
@@ -760,6 +815,7 @@ void handleUpdateConfig() {
   themeColor = server.arg("theme");
   UtcOffset = server.arg("utcoffset").toFloat();
   DstUsed = server.hasArg("isDSTused");
+  NtpServers = server.arg("ntpServers");
   DayTimeBrightness = server.arg("daytimebrightness").toInt();
   NightTimeBrightness = server.arg("nighttimebrightness").toInt();
   String temp = server.arg("userid");
@@ -769,8 +825,7 @@ void handleUpdateConfig() {
   writeSettings();
 #if defined(PRINTER_MON)
   findMDNS();
-  printerClient.getPrinterJobResults();
-  printerClient.getPrinterPsuState();
+  pollScheduler.pollNow();
 #endif
   if (INVERT_DISPLAY != flipOld) {
     ui.init();
@@ -779,7 +834,7 @@ void handleUpdateConfig() {
     ui.update();
   }
   checkDisplay();
-  lastEpoch = 0;
+  scheduler.runNow(weatherTask);
   redirectHome();
   refreshBrightness(true);
 }
@@ -796,60 +851,110 @@ void handleWifiReset() {
   ESP.restart();
 }
 
+const char* checkedIf(boolean value) {
+  return value ? "checked='checked'" : "";
+}
+
+void weatherFormField(PageWriter &page, const char* name) {
+  if (strcmp(name, "IS_WEATHER_CHECKED") == 0) {
+    page.print(checkedIf(DISPLAYWEATHER));
+  } else if (strcmp(name, "WEATHERKEY") == 0) {
+    page.print(WeatherApiKey.c_str());
+  } else if (strcmp(name, "CITYNAME1") == 0) {
+    page.print(weatherClient.getCity(0));
+  } else if (strcmp(name, "CITY1") == 0) {
+    page.print(CityIDs[0]);
+  } else if (strcmp(name, "METRIC") == 0) {
+    page.print(checkedIf(IS_METRIC));
+  } else if (strcmp(name, "LANGUAGEOPTIONS") == 0) {
+    page.printOptions(LANG_OPTIONS, WeatherLanguage.c_str());
+  } else if (strcmp(name, "IS_MQTT_CHECKED") == 0) {
+    page.print(checkedIf(MqttUse));
+  } else if (strcmp(name, "MQTT_SERVER") == 0) {
+    page.print(MqttServer.c_str());
+  } else if (strcmp(name, "MQTT_PORT") == 0) {
+    page.print(MqttPort);
+  } else if (strcmp(name, "MQTT_USER") == 0) {
+    page.print(MqttUser.c_str());
+  } else if (strcmp(name, "MQTT_PSW") == 0) {
+    page.print(MqttPsw.c_str());
+  } else if (strcmp(name, "MQTT_TEMP_TOPIC") == 0) {
+    page.print(MqttTempTopic.c_str());
+  } else if (strcmp(name, "MQTT_HUMD_TOPIC") == 0) {
+    page.print(MqttHumdTopic.c_str());
+  } else if (strcmp(name, "MQTT_LWT_TOPIC") == 0) {
+    page.print(MqttLwtTopic.c_str());
+  }
+}
+
 void handleWeatherConfigure() {
   if (!authentication()) {
     return server.requestAuthentication();
   }
   ledOnOff(true);
-  String html = "";
-
-  server.sendHeader("Cache-Control", "no-cache, no-store");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "-1");
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "text/html", "");
-
-  html = getHeader();
-  server.sendContent(html);
+  PageWriter page(server);
+  page.begin();
+  printHeader(page, false);
+  page.printTemplate(WEATHER_FORM, weatherFormField);
+  printFooter(page);
+  page.end();
+  ledOnOff(false);
+}
 
-  String form = FPSTR(WEATHER_FORM);
-  String isWeatherChecked = "";
-  if (DISPLAYWEATHER) {
-    isWeatherChecked = "checked='checked'";
+#if defined(PRINTER_MON)
+void pollFormField(PageWriter &page, const char* name) {
+  if (strcmp(name, "POLL_HEATING") == 0) {
+    page.print(PollHeatingSeconds);
+  } else if (strcmp(name, "POLL_PRINTING") == 0) {
+    page.print(PollPrintingSeconds);
+  } else if (strcmp(name, "POLL_FINISHING") == 0) {
+    page.print(PollFinishingSeconds);
+  } else if (strcmp(name, "POLL_IDLE") == 0) {
+    page.print(PollIdleSeconds);
+  } else if (strcmp(name, "POLL_OFFLINE") == 0) {
+    page.print(PollOfflineSeconds);
   }
-  form.replace("%IS_WEATHER_CHECKED%", isWeatherChecked);
-  form.replace("%WEATHERKEY%", WeatherApiKey);
-  form.replace("%CITYNAME1%", weatherClient.getCity(0));
-  form.replace("%CITY1%", String(CityIDs[0]));
-  String checked = "";
-  if (IS_METRIC) {
-    checked = "checked='checked'";
+}
+#endif
+
+void clockFormField(PageWriter &page, const char* name) {
+  if (strcmp(name, "IS_CLOCK_CHECKED") == 0) {
+    page.print(checkedIf(DISPLAYCLOCK));
+  } else if (strcmp(name, "IS_24HOUR_CHECKED") == 0) {
+    page.print(checkedIf(IS_24HOUR));
+  } else if (strcmp(name, "IS_INVDISP_CHECKED") == 0) {
+    page.print(checkedIf(INVERT_DISPLAY));
+  } else if (strcmp(name, "USEFLASH") == 0) {
+    page.print(checkedIf(USE_FLASH));
+  } else if (strcmp(name, "HAS_PSU_CHECKED") == 0) {
+    page.print(checkedIf(HAS_PSU));
+  } else if (strcmp(name, "OPTIONS") == 0) {
+    char selected[12];
+    snprintf(selected, sizeof(selected), "%d", minutesBetweenDataRefresh);
+    page.printOptions(REFRESH_OPTIONS, selected);
   }
-  form.replace("%METRIC%", checked);
-  String options = FPSTR(LANG_OPTIONS);
-  options.replace(">"+String(WeatherLanguage)+"<", " selected>"+String(WeatherLanguage)+"<");
-  form.replace("%LANGUAGEOPTIONS%", options);
+}
 
-  String mqtt_checked = "";
-  if (MqttUse) {
-    mqtt_checked = "checked='checked'";
-  }
-  form.replace("%IS_MQTT_CHECKED%", mqtt_checked);
-  form.replace("%MQTT_SERVER%", MqttServer);
-  form.replace("%MQTT_PORT%", String(MqttPort));
-  form.replace("%MQTT_USER%", MqttUser);
-  form.replace("%MQTT_PSW%", MqttPsw);
-  form.replace("%MQTT_TEMP_TOPIC%", MqttTempTopic);
-  form.replace("%MQTT_HUMD_TOPIC%", MqttHumdTopic);
-  form.replace("%MQTT_LWT_TOPIC%", MqttLwtTopic);
-
-  server.sendContent(form);
-
-  html = getFooter();
-  server.sendContent(html);
-  server.sendContent("");
-  server.client().stop();
-  ledOnOff(false);
+void themeFormField(PageWriter &page, const char* name) {
+  if (strcmp(name, "THEME_OPTIONS") == 0) {
+    page.printOptions(COLOR_THEMES, themeColor.c_str());
+  } else if (strcmp(name, "UTCOFFSET") == 0) {
+    page.print(UtcOffset);
+  } else if (strcmp(name, "IS_DST_CHECKED") == 0) {
+    page.print(checkedIf(DstUsed));
+  } else if (strcmp(name, "NTPSERVERS") == 0) {
+    page.print(NtpServers.c_str());
+  } else if (strcmp(name, "DAYTIMEBRIGHTNESS") == 0) {
+    page.print(DayTimeBrightness);
+  } else if (strcmp(name, "NIGHTTIMEBRIGHTNESS") == 0) {
+    page.print(NightTimeBrightness);
+  } else if (strcmp(name, "IS_BASICAUTH_CHECKED") == 0) {
+    page.print(checkedIf(IS_BASIC_AUTH));
+  } else if (strcmp(name, "USERID") == 0) {
+    page.print(www_username);
+  } else if (strcmp(name, "STATIONPASSWORD") == 0) {
+    page.print(www_password);
+  }
 }
 
 void handleConfigure() {
@@ -857,42 +962,16 @@ void handleConfigure() {
     return server.requestAuthentication();
   }
   ledOnOff(true);
-  String html = "";
-
-  server.sendHeader("Cache-Control", "no-cache, no-store");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "-1");
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "text/html", "");
+  PageWriter page(server);
+  page.begin();
+  printHeader(page, false);
 
-  html = getHeader();
-  server.sendContent(html);
-
-  CHANGE_FORM =       "<form class='w3-container' action='/updateconfig' method='get'><h2>Station Config:</h2>";
 #if defined(PRINTER_MON)
-  CHANGE_FORM +=     "<p><label>" + printerClient.getPrinterType() + " API Key (get from your server)</label>"
-                      "<input class='w3-input w3-border w3-margin-bottom' type='text' name='PrinterApiKey' id='PrinterApiKey' value='%OCTOKEY%' maxlength='60'></p>";
-  if (printerClient.getPrinterType() == "OctoPrint") {
-    CHANGE_FORM +=      "<p><label>" + printerClient.getPrinterType() + " Host Name (usually octopi)</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='PrinterHostName' value='%OCTOHOST%' maxlength='60'></p>";
-  }
-  CHANGE_FORM +=      "<p><label>" + printerClient.getPrinterType() + " Address (do not include http://)</label>"
-                      "<input class='w3-input w3-border w3-margin-bottom' type='text' name='PrinterAddress' id='PrinterAddress' value='%OCTOADDRESS%' maxlength='60'></p>"
-                      "<p><label>" + printerClient.getPrinterType() + " Port</label>"
-                      "<input class='w3-input w3-border w3-margin-bottom' type='text' name='PrinterPort' id='PrinterPort' value='%OCTOPORT%' maxlength='5'  onkeypress='return isNumberKey(event)'></p>";
-  if (printerClient.getPrinterType() == "Repetier") {
-    CHANGE_FORM +=    "<input type='button' value='Test Connection' onclick='testRepetier()'>"
-                      "<input type='hidden' id='selectedPrinter' value='" + printerClient.getPrinterName() + "'><p id='RepetierTest'></p>"
-                      "<script>testRepetier();</script>";
-  } else {
-    CHANGE_FORM +=    "<input type='button' value='Test Connection and API JSON Response' onclick='testOctoPrint()'><p id='OctoPrintTest'></p>";
-  }
-  CHANGE_FORM +=      "<p><label>" + printerClient.getPrinterType() + " User (only needed if you have haproxy or basic auth turned on)</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='octoUser' value='%OCTOUSER%' maxlength='30'></p>"
-                      "<p><label>" + printerClient.getPrinterType() + " Password </label><input class='w3-input w3-border w3-margin-bottom' type='password' name='octoPass' value='%OCTOPASS%'></p>";
-
-
-
-  if (printerClient.getPrinterType() == "Repetier") {
-    html = "<script>function testRepetier(){var e=document.getElementById(\"RepetierTest\"),r=document.getElementById(\"PrinterAddress\").value,"
+  String printerType = printerClient.getPrinterType();
+  const char* type = printerType.c_str();
+  boolean isRepetier = printerType == "Repetier";
+  if (isRepetier) {
+    page.print(F("<script>function testRepetier(){var e=document.getElementById(\"RepetierTest\"),r=document.getElementById(\"PrinterAddress\").value,"
            "t=document.getElementById(\"PrinterPort\").value;if(\"\"==r||\"\"==t)return e.innerHTML=\"* Address and Port are required\","
            "void(e.style.background=\"\");var n=\"http://\"+r+\":\"+t;n+=\"/printer/api/?a=listPrinter&apikey=\"+document.getElementById(\"PrinterApiKey\").value,"
            "console.log(n);var o=new XMLHttpRequest;o.open(\"GET\",n,!0),o.onload=function(){if(200===o.status){var r=JSON.parse(o.responseText);"
@@ -901,110 +980,54 @@ void handleConfigure() {
            "t+=\"<option value='\"+r[printer].slug+\"' \"+i+\">\"+r[printer].name+\"</option>\";t+=\"</select>\","
            "e.innerHTML=t,e.style.background=\"lime\"}else e.innerHTML=\"Error invalid API Key: \"+r.error,"
            "e.style.background=\"red\"}else e.innerHTML=\"Error: \"+o.statusText,e.style.background=\"red\"},"
-           "o.onerror=function(){e.innerHTML=\"Error connecting to server -- check IP and Port\",e.style.background=\"red\"},o.send(null)}</script>";
-
-    server.sendContent(html);
+           "o.onerror=function(){e.innerHTML=\"Error connecting to server -- check IP and Port\",e.style.background=\"red\"},o.send(null)}</script>"));
   } else {
-    html = "<script>function testOctoPrint(){var e=document.getElementById(\"OctoPrintTest\"),t=document.getElementById(\"PrinterAddress\").value,"
+    page.print(F("<script>function testOctoPrint(){var e=document.getElementById(\"OctoPrintTest\"),t=document.getElementById(\"PrinterAddress\").value,"
            "n=document.getElementById(\"PrinterPort\").value;if(e.innerHTML=\"\",\"\"==t||\"\"==n)return e.innerHTML=\"* Address and Port are required\","
-           "void(e.style.background=\"\");var r=\"http://\"+t+\":\"+n;r+=\"/api/job?apikey=\"+document.getElementById(\"PrinterApiKey\").value,window.open(r,\"_blank\").focus()}</script>";
-    server.sendContent(html);
+           "void(e.style.background=\"\");var r=\"http://\"+t+\":\"+n;r+=\"/api/job?apikey=\"+document.getElementById(\"PrinterApiKey\").value,window.open(r,\"_blank\").focus()}</script>"));
   }
 #endif
 
-  String form = CHANGE_FORM;
-
+  page.print(F("<form class='w3-container' action='/updateconfig' method='get'><h2>Station Config:</h2>"));
 #if defined(PRINTER_MON)
-  form.replace("%OCTOKEY%", PrinterApiKey);
-  form.replace("%OCTOHOST%", PrinterHostName);
-  form.replace("%OCTOADDRESS%", PrinterServer);
-  form.replace("%OCTOPORT%", String(PrinterPort));
-  form.replace("%OCTOUSER%", PrinterAuthUser);
-  form.replace("%OCTOPASS%", PrinterAuthPass);
-#endif
-
-  server.sendContent(form);
-
-  form = FPSTR(CLOCK_FORM);
-
-  String isClockChecked = "";
-  if (DISPLAYCLOCK) {
-    isClockChecked = "checked='checked'";
-  }
-  form.replace("%IS_CLOCK_CHECKED%", isClockChecked);
-  String is24hourChecked = "";
-  if (IS_24HOUR) {
-    is24hourChecked = "checked='checked'";
-  }
-  form.replace("%IS_24HOUR_CHECKED%", is24hourChecked);
-  String isInvDisp = "";
-  if (INVERT_DISPLAY) {
-    isInvDisp = "checked='checked'";
-  }
-  form.replace("%IS_INVDISP_CHECKED%", isInvDisp);
-  String isFlashLED = "";
-  if (USE_FLASH) {
-    isFlashLED = "checked='checked'";
-  }
-  form.replace("%USEFLASH%", isFlashLED);
-  String hasPSUchecked = "";
-  if (HAS_PSU) {
-    hasPSUchecked = "checked='checked'";
+  page.format("<p><label>%s API Key (get from your server)</label>"
+              "<input class='w3-input w3-border w3-margin-bottom' type='text' name='PrinterApiKey' id='PrinterApiKey' value='%s' maxlength='60'></p>", type, PrinterApiKey.c_str());
+  if (printerType == "OctoPrint") {
+    page.format("<p><label>%s Host Name (usually octopi)</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='PrinterHostName' value='%s' maxlength='60'></p>", type, PrinterHostName.c_str());
+  }
+  page.format("<p><label>%s Address (do not include http://)</label>"
+              "<input class='w3-input w3-border w3-margin-bottom' type='text' name='PrinterAddress' id='PrinterAddress' value='%s' maxlength='60'></p>", type, PrinterServer.c_str());
+  page.format("<p><label>%s Port</label>"
+              "<input class='w3-input w3-border w3-margin-bottom' type='text' name='PrinterPort' id='PrinterPort' value='%d' maxlength='5'  onkeypress='return isNumberKey(event)'></p>", type, PrinterPort);
+  if (isRepetier) {
+    page.format("<input type='button' value='Test Connection' onclick='testRepetier()'>"
+                "<input type='hidden' id='selectedPrinter' value='%s'><p id='RepetierTest'></p>"
+                "<script>testRepetier();</script>", printerClient.getPrinterName().c_str());
+  } else {
+    page.print(F("<input type='button' value='Test Connection and API JSON Response' onclick='testOctoPrint()'><p id='OctoPrintTest'></p>"));
   }
-  form.replace("%HAS_PSU_CHECKED%", hasPSUchecked);
-
-  String options = "<option>10</option><option>15</option><option>20</option><option>30</option><option>60</option>";
-  options.replace(">"+String(minutesBetweenDataRefresh)+"<", " selected>"+String(minutesBetweenDataRefresh)+"<");
-  form.replace("%OPTIONS%", options);
-
-  server.sendContent(form);
-
-  form = FPSTR(THEME_FORM);
+  page.format("<p><label>%s User (only needed if you have haproxy or basic auth turned on)</label><input class='w3-input w3-border w3-margin-bottom' type='text' name='octoUser' value='%s' maxlength='30'></p>", type, PrinterAuthUser.c_str());
+  page.format("<p><label>%s Password </label><input class='w3-input w3-border w3-margin-bottom' type='password' name='octoPass' value='%s'></p>", type, PrinterAuthPass.c_str());
 
-  String themeOptions = FPSTR(COLOR_THEMES);
-  themeOptions.replace(">"+String(themeColor)+"<", " selected>"+String(themeColor)+"<");
-  form.replace("%THEME_OPTIONS%", themeOptions);
-  form.replace("%UTCOFFSET%", String(UtcOffset));
-  String isDstChecked = "";
-  if (DstUsed) {
-    isDstChecked = "checked='checked'";
-  }
-  form.replace("%IS_DST_CHECKED%", isDstChecked);
-  form.replace("%DAYTIMEBRIGHTNESS%", String(DayTimeBrightness));
-  form.replace("%NIGHTTIMEBRIGHTNESS%", String(NightTimeBrightness));
-  String isUseSecurityChecked = "";
-  if (IS_BASIC_AUTH) {
-    isUseSecurityChecked = "checked='checked'";
-  }
-  form.replace("%IS_BASICAUTH_CHECKED%", isUseSecurityChecked);
-  form.replace("%USERID%", String(www_username));
-  form.replace("%STATIONPASSWORD%", String(www_password));
+  page.printTemplate(POLL_FORM, pollFormField);
+#endif
 
-  server.sendContent(form);
+  page.printTemplate(CLOCK_FORM, clockFormField);
+  page.printTemplate(THEME_FORM, themeFormField);
 
-  html = getFooter();
-  server.sendContent(html);
-  server.sendContent("");
-  server.client().stop();
+  printFooter(page);
+  page.end();
   ledOnOff(false);
 }
 
-void displayMessage(String message) {
+void displayMessage(const char* message) {
   ledOnOff(true);
-
-  server.sendHeader("Cache-Control", "no-cache, no-store");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "-1");
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "text/html", "");
-  String html = getHeader();
-  server.sendContent(String(html));
-  server.sendContent(String(message));
-  html = getFooter();
-  server.sendContent(String(html));
-  server.sendContent("");
-  server.client().stop();
-
+  PageWriter page(server);
+  page.begin();
+  printHeader(page, false);
+  page.print(message);
+  printFooter(page);
+  page.end();
   ledOnOff(false);
 }
 
@@ -1018,189 +1041,154 @@ void redirectHome() {
   server.client().stop();
 }
 
-String getHeader() {
-  return getHeader(false);
-}
-
-String getHeader(boolean refresh) {
-  String menu = FPSTR(WEB_ACTIONS);
-
-  String html = "<!DOCTYPE HTML>";
+void printHeader(PageWriter &page, boolean refresh) {
 #if defined(PRINTER_MON)
-  html += "<html><head><title>Printer Monitor</title><link rel='icon' href='data:;base64,='>";
+  page.print(F("<!DOCTYPE HTML><html><head><title>Printer Monitor</title><link rel='icon' href='data:;base64,='>"));
 #else
-  html += "<html><head><title>Weather Station</title><link rel='icon' href='data:;base64,='>";
+  page.print(F("<!DOCTYPE HTML><html><head><title>Weather Station</title><link rel='icon' href='data:;base64,='>"));
 #endif
-  html += "<meta charset='UTF-8'>";
-  html += "<meta name='viewport' content='width=device-width, initial-scale=1'>";
+  page.print(F("<meta charset='UTF-8'>"
+               "<meta name='viewport' content='width=device-width, initial-scale=1'>"));
   if (refresh) {
-    html += "<meta http-equiv=\"refresh\" content=\"30\">";
-  }
-  html += "<link rel='stylesheet' href='https://www.w3schools.com/w3css/4/w3.css'>";
-  html += "<link rel='stylesheet' href='https://www.w3schools.com/lib/w3-theme-" + themeColor + ".css'>";
-  html += "<link rel='stylesheet' href='https://cdnjs.cloudflare.com/ajax/libs/font-awesome/4.7.0/css/font-awesome.min.css'>";
-  html += "</head><body>";
-  html += "<nav class='w3-sidebar w3-bar-block w3-card' style='margin-top:88px' id='mySidebar'>";
-  html += "<div class='w3-container w3-theme-d2'>";
-  html += "<span onclick='closeSidebar()' class='w3-button w3-display-topright w3-large'><i class='fa fa-times'></i></span>";
-  html += "<div class='w3-cell w3-left w3-xxxlarge' style='width:60px'><i class='fa fa-cube'></i></div>";
-  html += "<div class='w3-padding'>Menu</div></div>";
-  html += menu;
-  html += "</nav>";
+    page.print(F("<meta http-equiv=\"refresh\" content=\"30\">"));
+  }
+  page.print(F("<link rel='stylesheet' href='https://www.w3schools.com/w3css/4/w3.css'>"));
+  page.format("<link rel='stylesheet' href='https://www.w3schools.com/lib/w3-theme-%s.css'>", themeColor.c_str());
+  page.print(F("<link rel='stylesheet' href='https://cdnjs.cloudflare.com/ajax/libs/font-awesome/4.7.0/css/font-awesome.min.css'>"
+               "</head><body>"
+               "<nav class='w3-sidebar w3-bar-block w3-card' style='margin-top:88px' id='mySidebar'>"
+               "<div class='w3-container w3-theme-d2'>"
+               "<span onclick='closeSidebar()' class='w3-button w3-display-topright w3-large'><i class='fa fa-times'></i></span>"
+               "<div class='w3-cell w3-left w3-xxxlarge' style='width:60px'><i class='fa fa-cube'></i></div>"
+               "<div class='w3-padding'>Menu</div></div>"));
+  page.print(FPSTR(WEB_ACTIONS));
+  page.print(F("</nav>"));
 #if defined(PRINTER_MON)
-  html += "<header class='w3-top w3-bar w3-theme'><button class='w3-bar-item w3-button w3-xxxlarge w3-hover-theme' onclick='openSidebar()'><i class='fa fa-bars'></i></button><h2 class='w3-bar-item'>Printer Monitor</h2></header>";
+  page.print(F("<header class='w3-top w3-bar w3-theme'><button class='w3-bar-item w3-button w3-xxxlarge w3-hover-theme' onclick='openSidebar()'><i class='fa fa-bars'></i></button><h2 class='w3-bar-item'>Printer Monitor</h2></header>"));
 #else
-  html += "<header class='w3-top w3-bar w3-theme'><button class='w3-bar-item w3-button w3-xxxlarge w3-hover-theme' onclick='openSidebar()'><i class='fa fa-bars'></i></button><h2 class='w3-bar-item'>Weather Station</h2></header>";
+  page.print(F("<header class='w3-top w3-bar w3-theme'><button class='w3-bar-item w3-button w3-xxxlarge w3-hover-theme' onclick='openSidebar()'><i class='fa fa-bars'></i></button><h2 class='w3-bar-item'>Weather Station</h2></header>"));
 #endif
-  html += "<script>";
-  html += "function openSidebar(){document.getElementById('mySidebar').style.display='block'}function closeSidebar(){document.getElementById('mySidebar').style.display='none'}closeSidebar();";
-  html += "</script>";
-  html += "<br><div class='w3-container w3-large' style='margin-top:88px'>";
-  return html;
+  page.print(F("<script>"
+               "function openSidebar(){document.getElementById('mySidebar').style.display='block'}function closeSidebar(){document.getElementById('mySidebar').style.display='none'}closeSidebar();"
+               "</script>"
+               "<br><div class='w3-container w3-large' style='margin-top:88px'>"));
 }
 
-String getFooter() {
+void printFooter(PageWriter &page) {
   int8_t rssi = getWifiQuality();
-  Serial.print("Signal Strength (RSSI): ");
-  Serial.print(rssi);
-  Serial.println("%");
-  String html = "<br><br><br>";
-  html += "</div>";
-  html += "<footer class='w3-container w3-bottom w3-theme w3-margin-top'>";
+  Serial.printf("Signal Strength (RSSI): %d%%\n", rssi);
+  page.print(F("<br><br><br></div>"
+               "<footer class='w3-container w3-bottom w3-theme w3-margin-top'>"));
   if (lastReportStatus != "") {
-    html += "<i class='fa fa-external-link'></i> Report Status: " + lastReportStatus + "<br>";
-  }
-  html += "<i class='fa fa-paper-plane-o'></i> Version: " + String(VERSION) + "<br>";
-  html += "<i class='fa fa-rss'></i> Signal Strength: ";
-  html += String(rssi) + "%";
-  html += "</footer>";
-  html += "</body></html>";
-  return html;
+    page.format("<i class='fa fa-external-link'></i> Report Status: %s<br>", lastReportStatus.c_str());
+  }
+  page.format("<i class='fa fa-paper-plane-o'></i> Version: %s<br>", VERSION);
+  page.format("<i class='fa fa-rss'></i> Signal Strength: %d%%", rssi);
+  page.print(F("</footer></body></html>"));
 }
 
 void displayPrinterStatus() {
   ledOnOff(true);
-  String html = "";
-
-  server.sendHeader("Cache-Control", "no-cache, no-store");
-  server.sendHeader("Pragma", "no-cache");
-  server.sendHeader("Expires", "-1");
-  server.setContentLength(CONTENT_LENGTH_UNKNOWN);
-  server.send(200, "text/html", "");
-  server.sendContent(String(getHeader(true)));
+  PageWriter page(server);
+  page.begin();
+  printHeader(page, true);
 
-  String displayTime = timeClient.getAmPmHours() + ":" + timeClient.getMinutes() + ":" + timeClient.getSeconds() + " " + timeClient.getAmPm();
-  if (IS_24HOUR) {
-    displayTime = timeClient.getHours() + ":" + timeClient.getMinutes() + ":" + timeClient.getSeconds();
-  }
+  const TimeSnapshot &now = timeClient.getSnapshot();
 
 #if defined(PRINTER_MON)
-  html += "<div class='w3-cell-row' style='width:100%'><h2>" + printerClient.getPrinterType() + " Monitor</h2></div><div class='w3-cell-row'>";
+  page.format("<div class='w3-cell-row' style='width:100%%'><h2>%s Monitor</h2></div><div class='w3-cell-row'>", printerClient.getPrinterType().c_str());
 #else
-  html += "<div class='w3-cell-row' style='width:100%'><h2>Weather Station</h2></div><div class='w3-cell-row'>";
+  page.print(F("<div class='w3-cell-row' style='width:100%'><h2>Weather Station</h2></div><div class='w3-cell-row'>"));
 #endif
-  html += "<div class='w3-cell w3-container' style='width:100%'><p>";
+  page.print(F("<div class='w3-cell w3-container' style='width:100%'><p>"));
 #if defined(PRINTER_MON)
   if (printerClient.getPrinterType() == "Repetier") {
-    html += "Printer Name: " + printerClient.getPrinterName() + " <a href='/configure' title='Configure'><i class='fa fa-cog'></i></a><br>";
+    page.format("Printer Name: %s <a href='/configure' title='Configure'><i class='fa fa-cog'></i></a><br>", printerClient.getPrinterName().c_str());
   } else {
-    html += "Host Name: " + PrinterHostName + " <a href='/configure' title='Configure'><i class='fa fa-cog'></i></a><br>";
+    page.format("Host Name: %s <a href='/configure' title='Configure'><i class='fa fa-cog'></i></a><br>", PrinterHostName.c_str());
   }
 
+  const PrinterState &printer = printerClient.getPrinterState();
   if (printerClient.getError() != "") {
-    html += "Status: Offline<br>";
-    html += "Reason: " + printerClient.getError() + "<br>";
+    page.format("Status: Offline<br>Reason: %s<br>", printerClient.getError().c_str());
+    if (printerClient.getDataAge() >= 0) {
+      page.format("Showing data from %lds ago<br>", printerClient.getDataAge());
+    }
+    CircuitBreaker &breaker = printerClient.getCircuitBreaker();
+    if (breaker.getState() == CIRCUIT_OPEN) {
+      page.format("Retry in: %ds (%d failures)<br>", breaker.getRetrySeconds(), breaker.getFailures());
+    }
   } else {
-    html += "Status: " + printerClient.getState();
-    if (printerClient.isPSUoff() && HAS_PSU) {
-      html += ", PSU off";
+    page.format("Status: %s", printerClient.getState().c_str());
+    if (printer.isPSUoff && HAS_PSU) {
+      page.print(F(", PSU off"));
     }
-    html += "<br>";
+    page.print(F("<br>"));
   }
 
-  if (printerClient.isPrinting()) {
-    html += "File: " + printerClient.getFileName() + "<br>";
-    float fileSize = printerClient.getFileSize().toFloat();
-    if (fileSize > 0) {
-      fileSize = fileSize / 1024;
-      html += "File Size: " + String(fileSize) + "KB<br>";
+  page.format("Circuit breaker: %s<br>", printerClient.getCircuitBreaker().getStateName().c_str());
+
+  if (printer.isPrinting) {
+    page.format("File: %s<br>", printer.fileName);
+    if (printer.fileSize > 0) {
+      page.format("File Size: %.2fKB<br>", float(printer.fileSize) / 1024);
     }
-    int filamentLength = printerClient.getFilamentLength().toInt();
-    if (filamentLength > 0) {
-      float fLength = float(filamentLength) / 1000;
-      html += "Filament: " + String(fLength) + "m<br>";
+    if (printer.filamentLength > 0) {
+      page.format("Filament: %.2fm<br>", float(printer.filamentLength) / 1000);
     }
 
-    html += "Tool Temperature: " + printerClient.getTempToolActual() + "&#176; C<br>";
-    if ( printerClient.getTempBedActual() != 0 ) {
-        html += "Bed Temperature: " + printerClient.getTempBedActual() + "&#176; C<br>";
+    page.format("Tool Temperature: %s&#176; C<br>", PrinterState::formatTenths(printer.toolTemp).c_str());
+    if (printer.bedTemp != PRINTER_TENTHS_UNKNOWN) {
+        page.format("Bed Temperature: %s&#176; C<br>", PrinterState::formatTenths(printer.bedTemp).c_str());
     }
 
-    int val = printerClient.getProgressPrintTimeLeft().toInt();
-    int hours = numberOfHours(val);
-    int minutes = numberOfMinutes(val);
-    int seconds = numberOfSeconds(val);
-    html += "Est. Print Time Left: " + zeroPad(hours) + ":" + zeroPad(minutes) + ":" + zeroPad(seconds) + "<br>";
+    int val = printer.getPrintTimeLeft();
+    page.format("Est. Print Time Left: %02d:%02d:%02d<br>", (int)numberOfHours(val), (int)numberOfMinutes(val), (int)numberOfSeconds(val));
 
-    val = printerClient.getProgressPrintTime().toInt();
-    hours = numberOfHours(val);
-    minutes = numberOfMinutes(val);
-    seconds = numberOfSeconds(val);
-    html += "Printing Time: " + zeroPad(hours) + ":" + zeroPad(minutes) + ":" + zeroPad(seconds) + "<br>";
-    html += "<style>#myProgress {width: 100%;background-color: #ddd;}#myBar {width: " + printerClient.getProgressCompletion() + "%;height: 30px;background-color: #4CAF50;}</style>";
-    html += "<div id=\"myProgress\"><div id=\"myBar\" class=\"w3-medium w3-center\">" + printerClient.getProgressCompletion() + "%</div></div>";
+    val = printer.progressPrintTime > 0 ? printer.progressPrintTime : 0;
+    page.format("Printing Time: %02d:%02d:%02d<br>", (int)numberOfHours(val), (int)numberOfMinutes(val), (int)numberOfSeconds(val));
+    int completion = printer.getCompletionPercent();
+    page.format("<style>#myProgress {width: 100%%;background-color: #ddd;}#myBar {width: %d%%;height: 30px;background-color: #4CAF50;}</style>", completion);
+    page.format("<div id=\"myProgress\"><div id=\"myBar\" class=\"w3-medium w3-center\">%d%%</div></div>", completion);
   } else {
-    html += "<hr>";
+    page.print(F("<hr>"));
   }
 #endif
 
-  html += "</p></div></div>";
-
-  html += "<div class='w3-cell-row' style='width:100%'><h2>Time: " + displayTime + "</h2></div>";
+  page.print(F("</p></div></div>"));
 
-  server.sendContent(html); // spit out what we got
-  html = "";
+  if (IS_24HOUR) {
+    page.format("<div class='w3-cell-row' style='width:100%%'><h2>Time: %s</h2></div>", now.time);
+  } else {
+    page.format("<div class='w3-cell-row' style='width:100%%'><h2>Time: %s %s</h2></div>", now.amPmTime, now.amPm);
+  }
 
   if (DISPLAYWEATHER) {
     if (weatherClient.getCity(0) == "") {
-      html += "<p>Please <a href='/configureweather'>Configure Weather</a> API</p>";
+      page.print(F("<p>Please <a href='/configureweather'>Configure Weather</a> API</p>"));
       if (weatherClient.getError() != "") {
-        html += "<p>Weather Error: <strong>" + weatherClient.getError() + "</strong></p>";
+        page.format("<p>Weather Error: <strong>%s</strong></p>", weatherClient.getError().c_str());
       }
     } else {
-      html += "<div class='w3-cell-row' style='width:100%'><h2>" + weatherClient.getCity(0) + ", " + weatherClient.getCountry(0) + "</h2></div><div class='w3-cell-row'>";
-      html += "<div class='w3-cell w3-left w3-medium' style='width:120px'>";
-      html += "<img src='http://openweathermap.org/img/w/" + weatherClient.getIcon(0) + ".png' alt='" + weatherClient.getDescription(0) + "'><br>";
-      html += weatherClient.getHumidity(0) + "% Humidity<br>";
-      html += weatherClient.getWind(0) + " <span class='w3-tiny'>" + getSpeedSymbol() + "</span> Wind<br>";
-      html += "<br><strong>";
-      if (isDayTime) {
-        html += "Day";
-      } else {
-        html += "Night";
-      }
-      html += " mode</strong><br>OLED Brightness<br>[0-255]: ";
-      if (isDayTime) {
-        html += String(DayTimeBrightness);
-      } else {
-        html += String(NightTimeBrightness);
-      }
-      html += "</strong><br>";
-      html += "</div>";
-      html += "<div class='w3-cell w3-container' style='width:100%'><p>";
-      html += weatherClient.getCondition(0) + " (" + weatherClient.getDescription(0) + ")<br>";
-      html += weatherClient.getTempRounded(0) + getTempSymbol(true) + "<br>";
-      html += "<a href='https://www.google.com/maps/@" + weatherClient.getLat(0) + "," + weatherClient.getLon(0) + ",10000m/data=!3m1!1e3' target='_BLANK'><i class='fa fa-map-marker' style='color:red'></i> Map It!</a><br>";
-      html += "</p></div></div>";
+      page.format("<div class='w3-cell-row' style='width:100%%'><h2>%s, %s</h2></div><div class='w3-cell-row'>", weatherClient.getCity(0).c_str(), weatherClient.getCountry(0).c_str());
+      page.print(F("<div class='w3-cell w3-left w3-medium' style='width:120px'>"));
+      page.format("<img src='http://openweathermap.org/img/w/%s.png' alt='%s'><br>", weatherClient.getIcon(0).c_str(), weatherClient.getDescription(0).c_str());
+      page.format("%s%% Humidity<br>", weatherClient.getHumidity(0).c_str());
+      page.format("%s <span class='w3-tiny'>%s</span> Wind<br>", weatherClient.getWind(0).c_str(), getSpeedSymbol().c_str());
+      page.format("<br><strong>%s mode</strong><br>OLED Brightness<br>[0-255]: %d</strong><br>",
+                  isDayTime ? "Day" : "Night", isDayTime ? DayTimeBrightness : NightTimeBrightness);
+      page.print(F("</div>"
+                   "<div class='w3-cell w3-container' style='width:100%'><p>"));
+      page.format("%s (%s)<br>", weatherClient.getCondition(0).c_str(), weatherClient.getDescription(0).c_str());
+      page.format("%s%s<br>", weatherClient.getTempRounded(0).c_str(), getTempSymbol(true).c_str());
+      page.format("<a href='https://www.google.com/maps/@%s,%s,10000m/data=!3m1!1e3' target='_BLANK'><i class='fa fa-map-marker' style='color:red'></i> Map It!</a><br>",
+                  weatherClient.getLat(0).c_str(), weatherClient.getLon(0).c_str());
+      page.print(F("</p></div></div>"));
     }
-
-    server.sendContent(html); // spit out what we got
-    html = ""; // fresh start
   }
 
-  server.sendContent(String(getFooter()));
-  server.sendContent("");
-  server.client().stop();
+  printFooter(page);
+  page.end();
   ledOnOff(false);
 }
 
@@ -1248,11 +1236,12 @@ void flashLED(int number, int delayTime) {
 
 #if defined(PRINTER_MON)
 void drawScreen1(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
-  String bed = printerClient.getValueRounded(printerClient.getTempBedActual());
-  String tool = printerClient.getValueRounded(printerClient.getTempToolActual());
+  const PrinterState &printer = printerClient.getPrinterState();
+  int bed = PrinterState::roundTenths(printer.bedTemp);
+  String tool = String(PrinterState::roundTenths(printer.toolTemp));
   display->setTextAlignment(TEXT_ALIGN_CENTER);
   display->setFont(ArialMT_Plain_16);
-  if (bed != "0") {
+  if (bed != 0) {
     display->drawString(29 + x, 0 + y, "Tool");
     display->drawString(89 + x, 0 + y, "Bed");
   } else {
@@ -1260,10 +1249,10 @@ void drawScreen1(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int
   }
   display->setTextAlignment(TEXT_ALIGN_LEFT);
   display->setFont(ArialMT_Plain_24);
-  if (bed != "0") {
+  if (bed != 0) {
     display->setTextAlignment(TEXT_ALIGN_LEFT);
     display->drawString(12 + x, 14 + y, tool + "°");
-    display->drawString(74 + x, 14 + y, bed + "°");
+    display->drawString(74 + x, 14 + y, String(bed) + "°");
   } else {
     display->setTextAlignment(TEXT_ALIGN_CENTER);
     display->drawString(64 + x, 14 + y, tool + "°");
@@ -1277,13 +1266,8 @@ void drawScreen2(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int
   display->drawString(64 + x, 0 + y, "Time Remaining");
   //display->setTextAlignment(TEXT_ALIGN_LEFT);
   display->setFont(ArialMT_Plain_24);
-  int val = printerClient.getProgressPrintTimeLeft().toInt();
-  int hours = numberOfHours(val);
-  int minutes = numberOfMinutes(val);
-  int seconds = numberOfSeconds(val);
-
-  String time = zeroPad(hours) + ":" + zeroPad(minutes) + ":" + zeroPad(seconds);
-  display->drawString(64 + x, 14 + y, time);
+  int val = printerClient.getPrinterState().getPrintTimeLeft();
+  display->drawString(64 + x, 14 + y, scratch.format("%02d:%02d:%02d", (int)numberOfHours(val), (int)numberOfMinutes(val), (int)numberOfSeconds(val)));
 }
 
 void drawScreen3(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
@@ -1293,25 +1277,20 @@ void drawScreen3(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int
   display->drawString(64 + x, 0 + y, "Printing Time");
   //display->setTextAlignment(TEXT_ALIGN_LEFT);
   display->setFont(ArialMT_Plain_24);
-  int val = printerClient.getProgressPrintTime().toInt();
-  int hours = numberOfHours(val);
-  int minutes = numberOfMinutes(val);
-  int seconds = numberOfSeconds(val);
-
-  String time = zeroPad(hours) + ":" + zeroPad(minutes) + ":" + zeroPad(seconds);
-  display->drawString(64 + x, 14 + y, time);
+  const PrinterState &printer = printerClient.getPrinterState();
+  int val = printer.progressPrintTime > 0 ? printer.progressPrintTime : 0;
+  display->drawString(64 + x, 14 + y, scratch.format("%02d:%02d:%02d", (int)numberOfHours(val), (int)numberOfMinutes(val), (int)numberOfSeconds(val)));
 }
 #endif
 
 void drawClock(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16_t y) {
   display->setTextAlignment(TEXT_ALIGN_CENTER);
 
-  String displayTime = timeClient.getAmPmHours() + ":" + timeClient.getMinutes() + ":" + timeClient.getSeconds();
-  if (IS_24HOUR) {
-    displayTime = timeClient.getHours() + ":" + timeClient.getMinutes() + ":" + timeClient.getSeconds();
-  }
+  // short strings fit in String's inline buffer, so drawing them does not touch the heap
+  const TimeSnapshot &now = timeClient.getSnapshot();
+  const char* displayTime = IS_24HOUR ? now.time : now.amPmTime;
 #if defined(PRINTER_MON)
-  String displayName = PrinterHostName;
+  String displayName = PrinterHostName.c_str();
   if (printerClient.getPrinterType() == "Repetier") {
     displayName = printerClient.getPrinterName();
   }
@@ -1320,9 +1299,8 @@ void drawClock(OLEDDisplay *display, OLEDDisplayUiState* state, int16_t x, int16
   display->setFont(ArialMT_Plain_24);
   display->drawString(64 + x, 17 + y, displayTime);
 #else
-  String displayDate = timeClient.getFormattedDate();;
   display->setFont(ArialMT_Plain_16);
-  display->drawString(64 + x, 0 + y, displayDate);
+  display->drawString(64 + x, 0 + y, now.date);
   display->setFont(ArialMT_Plain_24);
   display->drawString(64 + x, 17 + y, displayTime);
 #endif
@@ -1374,38 +1352,26 @@ String getSpeedSymbol() {
   return rtnValue;
 }
 
-String zeroPad(int value) {
-  String rtnValue = String(value);
-  if (value < 10) {
-    rtnValue = "0" + rtnValue;
-  }
-  return rtnValue;
-}
-
 void drawHeaderOverlay(OLEDDisplay *display, OLEDDisplayUiState* state) {
   display->setColor(WHITE);
   display->setFont(ArialMT_Plain_16);
-  String displayTime = timeClient.getAmPmHours() + ":" + timeClient.getMinutes();
-  if (IS_24HOUR) {
-    displayTime = timeClient.getHours() + ":" + timeClient.getMinutes();
-  }
+  const TimeSnapshot &now = timeClient.getSnapshot();
   display->setTextAlignment(TEXT_ALIGN_LEFT);
-  display->drawString(0, 48, displayTime);
+  display->drawString(0, 48, IS_24HOUR ? now.shortTime : now.amPmShortTime);
 
   if (!IS_24HOUR) {
-    String ampm = timeClient.getAmPm();
     display->setFont(ArialMT_Plain_10);
-    display->drawString(39, 54, ampm);
+    display->drawString(39, 54, now.amPm);
   }
 
 #if defined(PRINTER_MON)
   display->setFont(ArialMT_Plain_16);
   display->setTextAlignment(TEXT_ALIGN_LEFT);
-  String percent = String(printerClient.getProgressCompletion()) + "%";
-  display->drawString(64, 48, percent);
+  int completion = printerClient.getPrinterState().getCompletionPercent();
+  display->drawString(64, 48, String(completion) + "%");
 
   // Draw indicator to show next update
-  int updatePos = (printerClient.getProgressCompletion().toFloat() / float(100)) * 128;
+  int updatePos = completion * 128 / 100;
   display->drawRect(0, 41, 128, 6);
   display->drawHorizontalLine(0, 42, updatePos);
   display->drawHorizontalLine(0, 43, updatePos);
@@ -1427,12 +1393,12 @@ void drawClockHeaderOverlay(OLEDDisplay *display, OLEDDisplayUiState* state) {
   display->setFont(ArialMT_Plain_16);
   display->setTextAlignment(TEXT_ALIGN_LEFT);
   if (!IS_24HOUR) {
-    display->drawString(0, 48, timeClient.getAmPm());
+    display->drawString(0, 48, timeClient.getSnapshot().amPm);
     display->setTextAlignment(TEXT_ALIGN_CENTER);
 #if defined(PRINTER_MON)
     if (printerClient.isPSUoff()) {
       display->drawString(64, 47, "psu off");
-    } else if (printerClient.getState() == "Operational") {
+    } else if (printerClient.getPrinterState().state == PRINTER_OPERATIONAL) {
       display->drawString(64, 47, "online");
     } else {
       display->drawString(64, 47, "offline");
@@ -1442,7 +1408,7 @@ void drawClockHeaderOverlay(OLEDDisplay *display, OLEDDisplayUiState* state) {
 #if defined(PRINTER_MON)
     if (printerClient.isPSUoff()) {
       display->drawString(40, 47, "psu off");
-    } else if (printerClient.getState() == "Operational") {
+    } else if (printerClient.getPrinterState().state == PRINTER_OPERATIONAL) {
       display->drawString(40, 47, "online");
     } else {
       display->drawString(40, 47, "offline");
@@ -1558,17 +1524,23 @@ void writeSettings() {
     Serial.println("Saving settings now...");
     f.println("UtcOffset=" + String(UtcOffset));
     f.println("DstUsed=" + String(DstUsed));
+    f.printf("ntpServers=%s\n", NtpServers.c_str());
 #if defined(PRINTER_MON)
-    f.println("printerApiKey=" + PrinterApiKey);
-    f.println("printerHostName=" + PrinterHostName);
-    f.println("printerServer=" + PrinterServer);
+    f.printf("printerApiKey=%s\n", PrinterApiKey.c_str());
+    f.printf("printerHostName=%s\n", PrinterHostName.c_str());
+    f.printf("printerServer=%s\n", PrinterServer.c_str());
     f.println("printerPort=" + String(PrinterPort));
     f.println("printerName=" + printerClient.getPrinterName());
-    f.println("printerAuthUser=" + PrinterAuthUser);
-    f.println("printerAuthPass=" + PrinterAuthPass);
+    f.printf("printerAuthUser=%s\n", PrinterAuthUser.c_str());
+    f.printf("printerAuthPass=%s\n", PrinterAuthPass.c_str());
+    f.println("pollHeating=" + String(PollHeatingSeconds));
+    f.println("pollPrinting=" + String(PollPrintingSeconds));
+    f.println("pollFinishing=" + String(PollFinishingSeconds));
+    f.println("pollIdle=" + String(PollIdleSeconds));
+    f.println("pollOffline=" + String(PollOfflineSeconds));
 #endif
     f.println("refreshRate=" + String(minutesBetweenDataRefresh));
-    f.println("themeColor=" + themeColor);
+    f.printf("themeColor=%s\n", themeColor.c_str());
     f.println("IS_BASIC_AUTH=" + String(IS_BASIC_AUTH));
     f.println("www_username=" + String(www_username));
     f.println("www_password=" + String(www_password));
@@ -1577,18 +1549,18 @@ void writeSettings() {
     f.println("invertDisp=" + String(INVERT_DISPLAY));
     f.println("USE_FLASH=" + String(USE_FLASH));
     f.println("isWeather=" + String(DISPLAYWEATHER));
-    f.println("weatherKey=" + WeatherApiKey);
+    f.printf("weatherKey=%s\n", WeatherApiKey.c_str());
     f.println("CityID=" + String(CityIDs[0]));
     f.println("isMetric=" + String(IS_METRIC));
-    f.println("language=" + String(WeatherLanguage));
+    f.printf("language=%s\n", WeatherLanguage.c_str());
     f.println("isMqttEnabled=" + String(MqttUse));
-    f.println("mqttServer=" + String(MqttServer));
+    f.printf("mqttServer=%s\n", MqttServer.c_str());
     f.println("mqttPort=" + String(MqttPort));
-    f.println("mqttUser=" + String(MqttUser));
-    f.println("mqttPsw=" + String(MqttPsw));
-    f.println("mqttTempTopic=" + String(MqttTempTopic));
-    f.println("mqttHumdTopic=" + String(MqttHumdTopic));
-    f.println("mqttLwtTopic=" + String(MqttLwtTopic));
+    f.printf("mqttUser=%s\n", MqttUser.c_str());
+    f.printf("mqttPsw=%s\n", MqttPsw.c_str());
+    f.printf("mqttTempTopic=%s\n", MqttTempTopic.c_str());
+    f.printf("mqttHumdTopic=%s\n", MqttHumdTopic.c_str());
+    f.printf("mqttLwtTopic=%s\n", MqttLwtTopic.c_str());
     f.println("hasPSU=" + String(HAS_PSU));
     f.println("dayTimeBrightness=" + String(DayTimeBrightness));
     f.println("nightTimeBrightness=" + String(NightTimeBrightness));
@@ -1617,21 +1589,26 @@ void readSettings() {
       DstUsed = line.substring(line.lastIndexOf("DstUsed=") + 8).toInt();
       Serial.println("DstUsed=" + String(DstUsed));
     }
+    if (line.indexOf("ntpServers=") >= 0) {
+      NtpServers = line.substring(line.lastIndexOf("ntpServers=") + 11);
+      NtpServers.trim();
+      Serial.printf("NtpServers=%s\n", NtpServers.c_str());
+    }
 #if defined(PRINTER_MON)
     if (line.indexOf("printerApiKey=") >= 0) {
       PrinterApiKey = line.substring(line.lastIndexOf("printerApiKey=") + 14);
       PrinterApiKey.trim();
-      Serial.println("PrinterApiKey=" + PrinterApiKey);
+      Serial.printf("PrinterApiKey=%s\n", PrinterApiKey.c_str());
     }
     if (line.indexOf("printerHostName=") >= 0) {
       PrinterHostName = line.substring(line.lastIndexOf("printerHostName=") + 16);
       PrinterHostName.trim();
-      Serial.println("PrinterHostName=" + PrinterHostName);
+      Serial.printf("PrinterHostName=%s\n", PrinterHostName.c_str());
     }
     if (line.indexOf("printerServer=") >= 0) {
       PrinterServer = line.substring(line.lastIndexOf("printerServer=") + 14);
       PrinterServer.trim();
-      Serial.println("PrinterServer=" + PrinterServer);
+      Serial.printf("PrinterServer=%s\n", PrinterServer.c_str());
     }
     if (line.indexOf("printerPort=") >= 0) {
       PrinterPort = line.substring(line.lastIndexOf("printerPort=") + 12).toInt();
@@ -1646,12 +1623,32 @@ void readSettings() {
     if (line.indexOf("printerAuthUser=") >= 0) {
       PrinterAuthUser = line.substring(line.lastIndexOf("printerAuthUser=") + 16);
       PrinterAuthUser.trim();
-      Serial.println("PrinterAuthUser=" + PrinterAuthUser);
+      Serial.printf("PrinterAuthUser=%s\n", PrinterAuthUser.c_str());
     }
     if (line.indexOf("printerAuthPass=") >= 0) {
       PrinterAuthPass = line.substring(line.lastIndexOf("printerAuthPass=") + 16);
       PrinterAuthPass.trim();
-      Serial.println("PrinterAuthPass=" + PrinterAuthPass);
+      Serial.printf("PrinterAuthPass=%s\n", PrinterAuthPass.c_str());
+    }
+    if (line.indexOf("pollHeating=") >= 0) {
+      PollHeatingSeconds = line.substring(line.lastIndexOf("pollHeating=") + 12).toInt();
+      Serial.println("PollHeatingSeconds=" + String(PollHeatingSeconds));
+    }
+    if (line.indexOf("pollPrinting=") >= 0) {
+      PollPrintingSeconds = line.substring(line.lastIndexOf("pollPrinting=") + 13).toInt();
+      Serial.println("PollPrintingSeconds=" + String(PollPrintingSeconds));
+    }
+    if (line.indexOf("pollFinishing=") >= 0) {
+      PollFinishingSeconds = line.substring(line.lastIndexOf("pollFinishing=") + 14).toInt();
+      Serial.println("PollFinishingSeconds=" + String(PollFinishingSeconds));
+    }
+    if (line.indexOf("pollIdle=") >= 0) {
+      PollIdleSeconds = line.substring(line.lastIndexOf("pollIdle=") + 9).toInt();
+      Serial.println("PollIdleSeconds=" + String(PollIdleSeconds));
+    }
+    if (line.indexOf("pollOffline=") >= 0) {
+      PollOfflineSeconds = line.substring(line.lastIndexOf("pollOffline=") + 12).toInt();
+      Serial.println("PollOfflineSeconds=" + String(PollOfflineSeconds));
     }
 #endif
     if (line.indexOf("refreshRate=") >= 0) {
@@ -1661,7 +1658,7 @@ void readSettings() {
     if (line.indexOf("themeColor=") >= 0) {
       themeColor = line.substring(line.lastIndexOf("themeColor=") + 11);
       themeColor.trim();
-      Serial.println("themeColor=" + themeColor);
+      Serial.printf("themeColor=%s\n", themeColor.c_str());
     }
     if (line.indexOf("IS_BASIC_AUTH=") >= 0) {
       IS_BASIC_AUTH = line.substring(line.lastIndexOf("IS_BASIC_AUTH=") + 14).toInt();
@@ -1706,7 +1703,7 @@ void readSettings() {
     if (line.indexOf("weatherKey=") >= 0) {
       WeatherApiKey = line.substring(line.lastIndexOf("weatherKey=") + 11);
       WeatherApiKey.trim();
-      Serial.println("WeatherApiKey=" + WeatherApiKey);
+      Serial.printf("WeatherApiKey=%s\n", WeatherApiKey.c_str());
     }
     if (line.indexOf("CityID=") >= 0) {
       CityIDs[0] = line.substring(line.lastIndexOf("CityID=") + 7).toInt();
@@ -1719,7 +1716,7 @@ void readSettings() {
     if (line.indexOf("language=") >= 0) {
       WeatherLanguage = line.substring(line.lastIndexOf("language=") + 9);
       WeatherLanguage.trim();
-      Serial.println("WeatherLanguage=" + WeatherLanguage);
+      Serial.printf("WeatherLanguage=%s\n", WeatherLanguage.c_str());
     }
     if (line.indexOf("isMqttEnabled=") >= 0) {
       MqttUse = line.substring(line.lastIndexOf("isMqttEnabled=") + 14).toInt();
@@ -1728,7 +1725,7 @@ void readSettings() {
     if (line.indexOf("mqttServer=") >= 0) {
       MqttServer = line.substring(line.lastIndexOf("mqttServer=") + 11);
       MqttServer.trim();
-      Serial.println("MqttServer=" + MqttServer);
+      Serial.printf("MqttServer=%s\n", MqttServer.c_str());
     }
     if (line.indexOf("mqttPort=") >= 0) {
       MqttPort = line.substring(line.lastIndexOf("mqttPort=") + 9).toInt();
@@ -1737,27 +1734,27 @@ void readSettings() {
     if (line.indexOf("mqttUser=") >= 0) {
       MqttUser = line.substring(line.lastIndexOf("mqttUser=") + 9);
       MqttUser.trim();
-      Serial.println("MqttUser=" + MqttUser);
+      Serial.printf("MqttUser=%s\n", MqttUser.c_str());
     }
     if (line.indexOf("mqttPsw=") >= 0) {
       MqttPsw = line.substring(line.lastIndexOf("mqttPsw=") + 8);
       MqttPsw.trim();
-      Serial.println("MqttPsw=" + MqttPsw);
+      Serial.printf("MqttPsw=%s\n", MqttPsw.c_str());
     }
     if (line.indexOf("mqttTempTopic=") >= 0) {
       MqttTempTopic = line.substring(line.lastIndexOf("mqttTempTopic=") + 14);
       MqttTempTopic.trim();
-      Serial.println("MqttTempTopic=" + MqttTempTopic);
+      Serial.printf("MqttTempTopic=%s\n", MqttTempTopic.c_str());
     }
     if (line.indexOf("mqttHumdTopic=") >= 0) {
       MqttHumdTopic = line.substring(line.lastIndexOf("mqttHumdTopic=") + 14);
       MqttHumdTopic.trim();
-      Serial.println("MqttHumdTopic=" + MqttHumdTopic);
+      Serial.printf("MqttHumdTopic=%s\n", MqttHumdTopic.c_str());
     }
     if (line.indexOf("mqttLwtTopic=") >= 0) {
       MqttLwtTopic = line.substring(line.lastIndexOf("mqttLwtTopic=") + 13);
       MqttLwtTopic.trim();
-      Serial.println("MqttLwtTopic=" + MqttLwtTopic);
+      Serial.printf("MqttLwtTopic=%s\n", MqttLwtTopic.c_str());
     }
     if (line.indexOf("dayTimeBrightness=") >= 0) {
       DayTimeBrightness = line.substring(line.lastIndexOf("dayTimeBrightness=") + 18).toInt();
@@ -1770,27 +1767,66 @@ void readSettings() {
   }
   fr.close();
 #if defined(PRINTER_MON)
-  printerClient.updatePrintClient(PrinterApiKey, PrinterServer, PrinterPort, PrinterAuthUser, PrinterAuthPass, HAS_PSU);
+  printerClient.updatePrintClient(PrinterApiKey.c_str(), PrinterServer.c_str(), PrinterPort, PrinterAuthUser.c_str(), PrinterAuthPass.c_str(), HAS_PSU);
+  pollScheduler.setIntervals(PollHeatingSeconds, PollPrintingSeconds, PollFinishingSeconds, PollIdleSeconds, PollOfflineSeconds);
 #endif
-  weatherClient.updateWeatherApiKey(WeatherApiKey);
-  weatherClient.updateLanguage(WeatherLanguage);
+  weatherClient.updateWeatherApiKey(WeatherApiKey.c_str());
+  weatherClient.updateLanguage(WeatherLanguage.c_str());
   weatherClient.setMetric(IS_METRIC);
   weatherClient.updateCityIdList(CityIDs, 1);
+  scheduler.setInterval(weatherTask, minutesBetweenDataRefresh * 60000UL);
+  timeClient.setServers(NtpServers.c_str());
+  dstCache.reset();
   setUtcOffset();
 }
 
 void updateTime() {
   // DST
   utc = timeClient.getCurrentUnixEpoch();
-  local = myTZ.toLocal(utc);
+  local = dstCache.toLocal(utc);
+  if (dstCache.isDST() != offsetDst) {
+    setUtcOffset(); // passed a transition, syncs can be hours apart
+  }
   //printDateTime(utc, "UTC");
   //printDateTime(local, "EET");
 }
 
+#ifdef DST_BENCHMARK
+// Prints what the per loop local time lookup costs with the Timezone rules and with the cache.
+// Uses its own cache so the fixed sample time never reaches dstCache.
+void benchmarkDst() {
+  DstCache sampleCache(myTZ);
+  const time_t sample = 1700000000; // any fixed time, so runs compare
+  const int rounds = 100;
+  volatile boolean sink = false;
+
+  unsigned long started = micros();
+  for (int inx = 0; inx < rounds; inx++) {
+    time_t converted = myTZ.toLocal(sample + inx);
+    sink = myTZ.locIsDST(converted);
+  }
+  unsigned long rules = micros() - started;
+
+  sampleCache.toLocal(sample); // the one recalculation is not part of the loop cost
+  started = micros();
+  for (int inx = 0; inx < rounds; inx++) {
+    sampleCache.toLocal(sample + inx);
+    sink = sampleCache.isDST();
+  }
+  unsigned long cached = micros() - started;
+  (void)sink;
+
+  Serial.printf("Local time lookup per loop: Timezone rules %lu ns, cached transition %lu ns\n",
+    rules * 1000 / rounds, cached * 1000 / rounds);
+}
+#endif
+
 void setUtcOffset() {
-  updateTime();
+  utc = timeClient.getCurrentUnixEpoch();
+  local = dstCache.toLocal(utc);
+  offsetDst = dstCache.isDST();
 
-  bool dstActive = myTZ.locIsDST(local) && DstUsed;
+  bool dstActive = offsetDst && DstUsed;
   Serial.print("DST Active: ");
   Serial.println(dstActive);
   if (dstActive) {
@@ -1800,11 +1836,6 @@ void setUtcOffset() {
   }
 }
 
-int getMinutesFromLastRefresh() {
-  int minutes = (timeClient.getCurrentEpoch() - lastEpoch) / 60;
-  return minutes;
-}
-
 int getMinutesFromLastDisplay() {
   int minutes = (timeClient.getCurrentEpoch() - displayOffEpoch) / 60;
   return minutes;
@@ -1820,13 +1851,13 @@ void refreshBrightness(bool force) {
   }
 
   int offset = 0;
-  bool dstActive = myTZ.locIsDST(local) && DstUsed;
+  bool dstActive = dstCache.isDST() && DstUsed;
   if (dstActive) {
     offset = 1;
   }
 
-  if (local > weatherClient.getSunrise().toInt() + ((UtcOffset + offset) * 3600)
-    && local < weatherClient.getSunset().toInt() + ((UtcOffset + offset) * 3600)) {
+  if (local > weatherClient.getSunriseEpoch() + ((UtcOffset + offset) * 3600)
+    && local < weatherClient.getSunsetEpoch() + ((UtcOffset + offset) * 3600)) {
       if (!isDayTime) {
         display.setContrast(DayTimeBrightness);
         isDayTime = true;
@@ -1847,36 +1878,24 @@ void refreshBrightness(bool force) {
 
 // Toggle on and off the display if user defined times
 void checkDisplay() {
+  if (displayBanner != BANNER_NONE) {
+    return; // the last transition is still on the screen
+  }
   if (!displayOn && DISPLAYCLOCK) {
     enableDisplay(true);
   }
 #if defined(PRINTER_MON)
   if (displayOn && !printerClient.isPrinting() && !DISPLAYCLOCK) {
-    // Put Display to sleep
-    display.clear();
-    display.display();
-    display.setFont(ArialMT_Plain_16);
-    display.setTextAlignment(TEXT_ALIGN_CENTER);
-    display.setContrast(255); // default is 255
-    display.drawString(64, 5, "Printer Offline\nSleep Mode...");
-    display.display();
-    delay(5000);
-    enableDisplay(false);
+    // Put Display to sleep once the message has been read
+    showBanner(BANNER_SLEEP, "Printer Offline\nSleep Mode...");
     Serial.println("Printer is offline going down to sleep...");
     return;
   } else if (!displayOn && !DISPLAYCLOCK) {
     if (printerClient.isOperational()) {
       // Wake the Screen up
       enableDisplay(true);
-      display.clear();
-      display.display();
-      display.setFont(ArialMT_Plain_16);
-      display.setTextAlignment(TEXT_ALIGN_CENTER);
-      display.setContrast(255); // default is 255
-      display.drawString(64, 5, "Printer Online\nWake up...");
-      display.display();
+      showBanner(BANNER_WAKE, "Printer Online\nWake up...");
       Serial.println("Printer is online waking up...");
-      delay(5000);
       return;
     }
   } else
@@ -1917,12 +1936,32 @@ void checkDisplay() {
   refreshBrightness();
 }
 
+// Shows a full screen message for BANNER_TIME; only the UI waits for it to end
+void showBanner(DisplayBanner banner, const char* text) {
+  display.clear();
+  display.display();
+  display.setFont(ArialMT_Plain_16);
+  display.setTextAlignment(TEXT_ALIGN_CENTER);
+  display.setContrast(255); // default is 255
+  display.drawString(64, 5, text);
+  display.display();
+  displayBanner = banner;
+  scheduler.once("banner", BANNER_TIME, endBanner, COOP_PRIORITY_HIGH);
+}
+
+void endBanner() {
+  if (displayBanner == BANNER_SLEEP) {
+    enableDisplay(false);
+  }
+  displayBanner = BANNER_NONE;
+}
+
 void enableDisplay(boolean enable) {
   displayOn = enable;
   if (enable) {
     if (getMinutesFromLastDisplay() >= minutesBetweenDataRefresh) {
       // The display has been off longer than the minutes between refresh -- need to get fresh data
-      lastEpoch = 0; // this should force a data pull
+      scheduler.runNow(weatherTask); // this should force a data pull
       displayOffEpoch = 0;  // reset
     }
     display.displayOn();
@@ -0,0 +1,231 @@
+/** The MIT License (MIT)
+
+Copyright (c) 2018 David Payne
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+
+// Host test of JsonStreamExtractor, run from the repository root with
+//   pio test -e native
+
+#include <Arduino.h>
+#include <unity.h>
+#include "JsonStreamExtractor.h"
+
+#define MAX_FIELDS 8
+
+static char values[MAX_FIELDS][JSON_STREAM_VALUE_SIZE];
+static int calls[MAX_FIELDS];
+
+static void record(void* context, uint8_t field, const char* value) {
+  (void)context;
+  strncpy(values[field], value, JSON_STREAM_VALUE_SIZE - 1);
+  values[field][JSON_STREAM_VALUE_SIZE - 1] = '\0';
+  calls[field]++;
+}
+
+static void clearValues() {
+  memset(values, 0, sizeof(values));
+  memset(calls, 0, sizeof(calls));
+}
+
+#define CHECK(condition) TEST_ASSERT_TRUE(condition)
+#define CHECK_VALUE(field, expected) TEST_ASSERT_EQUAL_STRING(expected, values[field])
+
+void setUp() {
+}
+
+void tearDown() {
+}
+
+// Feeds the document in pieces of the given size, the way it arrives from the network
+static boolean parse(JsonStreamExtractor &extractor, const char* json, size_t piece) {
+  clearValues();
+  extractor.begin();
+  size_t length = strlen(json);
+  for (size_t inx = 0; inx < length; inx += piece) {
+    extractor.feed(json + inx, min(piece, length - inx));
+  }
+  return extractor.finish();
+}
+
+static void testNestedPaths() {
+  const JsonPath paths[] = {
+    {"job.file.name", 0},
+    {"job.file.size", 1},
+    {"state", 2},
+    {"state.flags.printing", 3},
+    {"progress.completion", 4}
+  };
+  JsonStreamExtractor extractor(paths, 5, record, NULL);
+  const char* json = "{\"job\": {\"file\": {\"name\": \"cube.gcode\", \"size\": 1234, \"date\": 5}},"
+    " \"other\": [1, 2, {\"state\": 9}], \"state\": {\"text\": \"Printing\", \"flags\": {\"printing\": true}},"
+    " \"progress\": {\"completion\": 42.5}}";
+  for (size_t piece = 1; piece <= strlen(json); piece *= 3) {
+    CHECK(parse(extractor, json, piece));
+    CHECK_VALUE(0, "cube.gcode");
+    CHECK_VALUE(1, "1234");
+    CHECK_VALUE(2, ""); // object, reported when it closes
+    CHECK_VALUE(3, "true");
+    CHECK_VALUE(4, "42.5");
+    CHECK(calls[1] == 1);
+  }
+}
+
+static void testEscapes() {
+  const JsonPath paths[] = {{"text", 0}, {"key\"quoted", 1}};
+  JsonStreamExtractor extractor(paths, 2, record, NULL);
+  CHECK(parse(extractor, "{\"text\": \"a\\\"b\\\\c\\/d\\n\\t\\u0041\\u00e9\", \"key\\\"quoted\": \"yes\"}", 1));
+  CHECK_VALUE(0, "a\"b\\c/d\n\tA?");
+  CHECK_VALUE(1, "yes");
+
+  CHECK(!parse(extractor, "{\"text\": \"\\u00g1\"}", 4)); // not a hex digit
+  CHECK(extractor.isFailed());
+}
+
+static void testNullAndMissing() {
+  const JsonPath paths[] = {{"a", 0}, {"b", 1}, {"c.d", 2}};
+  JsonStreamExtractor extractor(paths, 3, record, NULL);
+  strcpy(values[0], "stale");
+  CHECK(parse(extractor, "{\"a\": null, \"c\": {}}", 2));
+  CHECK_VALUE(0, "");
+  CHECK(calls[0] == 1);
+  CHECK(calls[1] == 1); // missing, reported by finish()
+  CHECK(calls[2] == 1);
+  CHECK_VALUE(2, "");
+}
+
+static void testWildcards() {
+  const JsonPath paths[] = {{"*.slug", 0}, {"*", 1}, {"$.tempRead", 2}, {"list.1", 3}};
+  JsonStreamExtractor extractor(paths, 4, record, NULL);
+  CHECK(parse(extractor, "[{\"slug\": \"one\"}, {\"slug\": \"two\"}, 7]", 5));
+  CHECK_VALUE(0, "two");
+  CHECK(calls[0] == 2);
+  CHECK(calls[1] == 3); // each element; the objects as "" when they close
+  CHECK_VALUE(1, "7");
+
+  extractor.setKey("mk3");
+  CHECK(parse(extractor, "{\"other\": {\"tempRead\": 20}, \"mk3\": {\"tempRead\": 215.3}, \"list\": [\"x\", \"y\"]}", 3));
+  CHECK_VALUE(2, "215.3");
+  CHECK(calls[2] == 1);
+  CHECK_VALUE(3, "y");
+}
+
+static void testTruncated() {
+  const JsonPath paths[] = {{"a", 0}, {"b", 1}};
+  JsonStreamExtractor extractor(paths, 2, record, NULL);
+  const char* json = "{\"a\": \"first\", \"b\": 12}";
+  for (size_t cut = 0; cut < strlen(json); cut++) {
+    clearValues();
+    extractor.begin();
+    extractor.feed(json, cut);
+    CHECK(!extractor.finish());
+  }
+  CHECK(parse(extractor, json, 7));
+  CHECK_VALUE(1, "12");
+
+  CHECK(!parse(extractor, "{\"a\" 1}", 1));
+  CHECK(extractor.isFailed());
+  CHECK(!parse(extractor, "{\"a\": 1,, \"b\": 2}", 1));
+  CHECK(extractor.isFailed());
+
+  // cut inside an escape, a \u sequence, an array and a literal: incomplete, not failed
+  CHECK(!parse(extractor, "{\"a\": \"x\\", 1));
+  CHECK(!extractor.isFailed());
+  CHECK(!parse(extractor, "{\"a\": \"\\u00", 1));
+  CHECK(!extractor.isFailed());
+  CHECK(!parse(extractor, "{\"a\": [1, 2", 1));
+  CHECK(!extractor.isFailed());
+  CHECK(!parse(extractor, "{\"b\": tru", 1));
+  CHECK(!extractor.isFailed());
+}
+
+static void testMismatchedBrackets() {
+  const JsonPath paths[] = {{"a", 0}, {"a.0", 1}};
+  JsonStreamExtractor extractor(paths, 2, record, NULL);
+  CHECK(!parse(extractor, "{\"a\":[1}", 1));
+  CHECK(extractor.isFailed());
+  CHECK(!parse(extractor, "{\"a\":[1]]", 1));
+  CHECK(extractor.isFailed());
+  CHECK(!parse(extractor, "[{\"a\":1]]", 1));
+  CHECK(extractor.isFailed());
+  CHECK(!parse(extractor, "{\"a\":{}]", 1));
+  CHECK(extractor.isFailed());
+  CHECK(!parse(extractor, "[1,2}", 1));
+  CHECK(extractor.isFailed());
+  CHECK(!parse(extractor, "{\"a\":[}", 1)); // empty array closed as an object
+  CHECK(extractor.isFailed());
+
+  CHECK(parse(extractor, "{\"a\":[1, [], {}, [{}]]}", 1));
+  CHECK_VALUE(1, "1");
+}
+
+static void testDepth() {
+  const JsonPath paths[] = {{"a.a.a.a.a.a.a.a", 0}};
+  JsonStreamExtractor extractor(paths, 1, record, NULL);
+  char json[64] = "";
+  for (int inx = 0; inx < JSON_STREAM_MAX_DEPTH; inx++) {
+    strcat(json, inx == 0 ? "{" : "\"a\": {");
+  }
+  strcat(json, "\"a\": 1");
+  for (int inx = 0; inx < JSON_STREAM_MAX_DEPTH; inx++) {
+    strcat(json, "}");
+  }
+  CHECK(parse(extractor, json, 1));
+  CHECK_VALUE(0, "1");
+
+  CHECK(!parse(extractor, "[[[[[[[[[1]]]]]]]]]", 1)); // one level too deep
+  CHECK(extractor.isFailed());
+
+  // objects and arrays count alike
+  CHECK(parse(extractor, "{\"a\":[{\"a\":[{\"a\":[{\"a\":[1]}]}]}]}", 1));
+  CHECK(!parse(extractor, "{\"a\":[{\"a\":[{\"a\":[{\"a\":[{}]}]}]}]}", 1));
+  CHECK(extractor.isFailed());
+
+  // begin() starts over after a rejected document
+  CHECK(parse(extractor, json, 4));
+  CHECK_VALUE(0, "1");
+}
+
+static void testLongValues() {
+  const JsonPath paths[] = {{"v", 0}, {"w", 1}};
+  JsonStreamExtractor extractor(paths, 2, record, NULL);
+  char json[512];
+  char longText[201];
+  memset(longText, 'x', 200);
+  longText[200] = '\0';
+  snprintf(json, sizeof(json), "{\"%s\": 1, \"v\": \"%s\", \"w\": 2}", longText, longText);
+  CHECK(parse(extractor, json, 16));
+  CHECK(strlen(values[0]) == JSON_STREAM_VALUE_SIZE - 1); // cut, not overflowed
+  CHECK_VALUE(1, "2");
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(testNestedPaths);
+  RUN_TEST(testEscapes);
+  RUN_TEST(testNullAndMissing);
+  RUN_TEST(testWildcards);
+  RUN_TEST(testTruncated);
+  RUN_TEST(testMismatchedBrackets);
+  RUN_TEST(testDepth);
+  RUN_TEST(testLongValues);
+  return UNITY_END();
+}